@@ -225,6 +225,8 @@ static struct kmem_cache *bfq_pool;
 /* hw_tag detection: parallel requests threshold and min samples needed. */
 #define BFQ_HW_QUEUE_THRESHOLD	3
 #define BFQ_HW_QUEUE_SAMPLES	32
+/* Minimum number of requests in driver for fast mode to engage. */
+#define BFQ_FAST_MODE_MIN_DEPTH	32
 
 #define BFQQ_SEEK_THR		(sector_t)(8 * 100)
 #define BFQQ_SECT_THR_NONROT	(sector_t)(2 * 32)
@@ -476,6 +478,15 @@ void bfq_schedule_dispatch(struct bfq_data *bfqd)
 
 #define bfq_class_idle(bfqq)	((bfqq)->ioprio_class == IOPRIO_CLASS_IDLE)
 
+/*
+ * Low-latency heuristics (weight raising) are in effect only if enabled
+ * and not overridden by fast mode.
+ */
+static bool bfq_low_latency(struct bfq_data *bfqd)
+{
+	return bfqd->low_latency && !bfqd->fast_mode_active;
+}
+
 #define bfq_sample_valid(samples)	((samples) > 80)
 
 /*
@@ -1161,7 +1172,7 @@ bfq_bfqq_resume_state(struct bfq_queue *bfqq, struct bfq_data *bfqd,
 	/*
 	 * Restore weight coefficient only if low_latency is on
 	 */
-	if (bfqd->low_latency) {
+	if (bfq_low_latency(bfqd)) {
 		old_wr_coeff = bfqq->wr_coeff;
 		bfqq->wr_coeff = bfqq_data->saved_wr_coeff;
 	}
@@ -1868,7 +1879,7 @@ static void bfq_bfqq_handle_idle_busy_switch(struct bfq_data *bfqd,
 	 * processes. So let also stably-merged queued enjoy weight
 	 * raising.
 	 */
-	wr_or_deserves_wr = bfqd->low_latency &&
+	wr_or_deserves_wr = bfq_low_latency(bfqd) &&
 		(bfqq->wr_coeff > 1 ||
 		 (bfq_bfqq_sync(bfqq) && bfqq_non_merged_or_stably_merged &&
 		  (*interactive || soft_rt)));
@@ -1905,7 +1916,7 @@ static void bfq_bfqq_handle_idle_busy_switch(struct bfq_data *bfqd,
 
 	bfq_clear_bfqq_just_created(bfqq);
 
-	if (bfqd->low_latency) {
+	if (bfq_low_latency(bfqd)) {
 		if (unlikely(time_is_after_jiffies(bfqq->split_time)))
 			/* wraparound */
 			bfqq->split_time =
@@ -2313,7 +2324,8 @@ static void bfq_add_request(struct request *rq)
 		bfq_bfqq_handle_idle_busy_switch(bfqd, bfqq, old_wr_coeff,
 						 rq, &interactive);
 	else {
-		if (bfqd->low_latency && old_wr_coeff == 1 && !rq_is_sync(rq) &&
+		if (bfq_low_latency(bfqd) && old_wr_coeff == 1 &&
+		    !rq_is_sync(rq) &&
 		    time_is_before_jiffies(
 				bfqq->last_wr_start_finish +
 				bfqd->bfq_wr_min_inter_arr_async)) {
@@ -2353,7 +2365,7 @@ static void bfq_add_request(struct request *rq)
 	 * this is already done in bfq_bfqq_handle_idle_busy_switch if
 	 * needed.
 	 */
-	if (bfqd->low_latency &&
+	if (bfq_low_latency(bfqd) &&
 		(old_wr_coeff == 1 || bfqq->wr_coeff == 1 || interactive))
 		bfqq->last_wr_start_finish = jiffies;
 }
@@ -2640,12 +2652,12 @@ void bfq_end_wr_async_queues(struct bfq_data *bfqd,
 	}
 }
 
-static void bfq_end_wr(struct bfq_data *bfqd)
+static void __bfq_end_wr(struct bfq_data *bfqd)
 {
 	struct bfq_queue *bfqq;
 	int i;
 
-	spin_lock_irq(&bfqd->lock);
+	lockdep_assert_held(&bfqd->lock);
 
 	for (i = 0; i < bfqd->num_actuators; i++) {
 		list_for_each_entry(bfqq, &bfqd->active_list[i], bfqq_list)
@@ -2654,7 +2666,12 @@ static void bfq_end_wr(struct bfq_data *bfqd)
 	list_for_each_entry(bfqq, &bfqd->idle_list, bfqq_list)
 		bfq_bfqq_end_wr(bfqq);
 	bfq_end_wr_async(bfqd);
+}
 
+static void bfq_end_wr(struct bfq_data *bfqd)
+{
+	spin_lock_irq(&bfqd->lock);
+	__bfq_end_wr(bfqd);
 	spin_unlock_irq(&bfqd->lock);
 }
 
@@ -3063,7 +3080,7 @@ static void bfq_bfqq_save_state(struct bfq_queue *bfqq)
 
 	if (unlikely(bfq_bfqq_just_created(bfqq) &&
 		     !bfq_bfqq_in_large_burst(bfqq) &&
-		     bfqq->bfqd->low_latency)) {
+		     bfq_low_latency(bfqq->bfqd))) {
 		/*
 		 * bfqq being merged right after being created: bfqq
 		 * would have deserved interactive weight raising, but
@@ -4366,10 +4383,10 @@ void bfq_bfqq_expire(struct bfq_data *bfqd,
 	      bfq_bfqq_budget_left(bfqq) >=  entity->budget / 3)))
 		bfq_bfqq_charge_time(bfqd, bfqq, delta);
 
-	if (bfqd->low_latency && bfqq->wr_coeff == 1)
+	if (bfq_low_latency(bfqd) && bfqq->wr_coeff == 1)
 		bfqq->last_wr_start_finish = jiffies;
 
-	if (bfqd->low_latency && bfqd->bfq_wr_max_softrt_rate > 0 &&
+	if (bfq_low_latency(bfqd) && bfqd->bfq_wr_max_softrt_rate > 0 &&
 	    RB_EMPTY_ROOT(&bfqq->sort_list)) {
 		/*
 		 * If we get here, and there are no outstanding
@@ -4595,6 +4612,15 @@ static bool bfq_better_to_idle(struct bfq_queue *bfqq)
 	if (unlikely(bfqd->strict_guarantees))
 		return true;
 
+	/*
+	 * In fast mode the device is non-rotational and keeps many
+	 * requests in flight: idling would only leave it underutilized,
+	 * so rely on budgets and timestamps alone to distribute the
+	 * throughput.
+	 */
+	if (bfqd->fast_mode_active)
+		return false;
+
 	/*
 	 * Idling is performed only if slice_idle > 0. In addition, we
 	 * do not idle if
@@ -6309,8 +6335,20 @@ static void bfq_update_hw_tag(struct bfq_data *bfqd)
 	bfqd->max_rq_in_driver = max_t(int, bfqd->max_rq_in_driver,
 				       bfqd->tot_rq_in_driver);
 
-	if (bfqd->hw_tag == 1)
+	if (bfqd->hw_tag == 1) {
+		/*
+		 * Engage fast mode, if enabled, once a non-rotational
+		 * queueing device has been seen to keep a deep queue. Weight
+		 * raising is disabled from then on, so end it for all queues.
+		 */
+		if (bfqd->fast_mode && !bfqd->fast_mode_active &&
+		    bfqd->nonrot_with_queueing &&
+		    bfqd->max_rq_in_driver >= BFQ_FAST_MODE_MIN_DEPTH) {
+			bfqd->fast_mode_active = true;
+			__bfq_end_wr(bfqd);
+		}
 		return;
+	}
 
 	/*
 	 * This sample is valid if the number of outstanding requests
@@ -7433,6 +7471,7 @@ SHOW_FUNCTION(bfq_max_budget_show, bfqd->bfq_user_max_budget, 0);
 SHOW_FUNCTION(bfq_timeout_sync_show, bfqd->bfq_timeout, 1);
 SHOW_FUNCTION(bfq_strict_guarantees_show, bfqd->strict_guarantees, 0);
 SHOW_FUNCTION(bfq_low_latency_show, bfqd->low_latency, 0);
+SHOW_FUNCTION(bfq_fast_mode_show, bfqd->fast_mode, 0);
 #undef SHOW_FUNCTION
 
 #define USEC_SHOW_FUNCTION(__FUNC, __VAR)				\
@@ -7593,6 +7632,26 @@ static ssize_t bfq_low_latency_store(struct elevator_queue *e,
 	return count;
 }
 
+static ssize_t bfq_fast_mode_store(struct elevator_queue *e,
+				   const char *page, size_t count)
+{
+	struct bfq_data *bfqd = e->elevator_data;
+	unsigned long __data;
+	int ret;
+
+	ret = bfq_var_store(&__data, (page));
+	if (ret)
+		return ret;
+
+	if (__data > 1)
+		__data = 1;
+	bfqd->fast_mode = __data;
+	if (!bfqd->fast_mode)
+		bfqd->fast_mode_active = false;
+
+	return count;
+}
+
 #define BFQ_ATTR(name) \
 	__ATTR(name, 0644, bfq_##name##_show, bfq_##name##_store)
 
@@ -7607,6 +7666,7 @@ static const struct elv_fs_entry bfq_attrs[] = {
 	BFQ_ATTR(timeout_sync),
 	BFQ_ATTR(strict_guarantees),
 	BFQ_ATTR(low_latency),
+	BFQ_ATTR(fast_mode),
 	__ATTR_NULL
 };
 
@@ -763,6 +763,15 @@ struct bfq_data {
 
 	/* if set to true, low-latency heuristics are enabled */
 	bool low_latency;
+	/*
+	 * If set to true, fast mode engages automatically on
+	 * non-rotational devices that keep a deep queue: device idling
+	 * and low-latency heuristics are then skipped, trading service
+	 * guarantees for throughput.
+	 */
+	bool fast_mode;
+	/* true if fast mode has engaged for the device */
+	bool fast_mode_active;
 	/*
 	 * Maximum factor by which the weight of a weight-raised queue
 	 * is multiplied.
@@ -25,6 +25,7 @@
 #include "blk-cgroup.h"
 
 #define ALLOC_CACHE_THRESHOLD	16
+#define ALLOC_CACHE_REFILL	16
 #define ALLOC_CACHE_MAX		256
 
 struct bio_alloc_cache {
@@ -441,6 +442,43 @@ static void bio_alloc_irq_cache_splice(struct bio_alloc_cache *cache)
 	local_irq_restore(flags);
 }
 
+/*
+ * Refill the per-cpu cache with a batch of bios allocated in bulk straight
+ * from the slab, leaving the mempool reserve alone. One of the new bios is
+ * returned to the caller, the others are added to the cache.
+ */
+static struct bio *bio_alloc_cache_refill(struct bio_set *bs, gfp_t gfp)
+{
+	struct bio_alloc_cache *cache;
+	void *p[ALLOC_CACHE_REFILL];
+	struct bio *bio;
+	int nr, i;
+
+	nr = kmem_cache_alloc_bulk(bs->bio_slab,
+				   (gfp & ~__GFP_DIRECT_RECLAIM) | __GFP_NOWARN,
+				   ALLOC_CACHE_REFILL, p);
+	if (!nr)
+		return NULL;
+
+	/* cached bios must be safe to hand to bio_free() */
+	for (i = 0; i < nr; i++) {
+		bio = p[i] + bs->front_pad;
+		bio_init(bio, NULL, NULL, 0, 0);
+		bio->bi_pool = bs;
+	}
+
+	cache = per_cpu_ptr(bs->cache, get_cpu());
+	for (i = 1; i < nr; i++) {
+		bio = p[i] + bs->front_pad;
+		bio->bi_next = cache->free_list;
+		cache->free_list = bio;
+		cache->nr++;
+	}
+	put_cpu();
+
+	return p[0] + bs->front_pad;
+}
+
 static struct bio *bio_alloc_percpu_cache(struct block_device *bdev,
 		unsigned short nr_vecs, blk_opf_t opf, gfp_t gfp,
 		struct bio_set *bs)
@@ -454,7 +492,10 @@ static struct bio *bio_alloc_percpu_cache(struct block_device *bdev,
 			bio_alloc_irq_cache_splice(cache);
 		if (!cache->free_list) {
 			put_cpu();
-			return NULL;
+			bio = bio_alloc_cache_refill(bs, gfp);
+			if (!bio)
+				return NULL;
+			goto init;
 		}
 	}
 	bio = cache->free_list;
@@ -462,6 +503,7 @@ static struct bio *bio_alloc_percpu_cache(struct block_device *bdev,
 	cache->nr--;
 	put_cpu();
 
+init:
 	bio_init(bio, bdev, nr_vecs ? bio->bi_inline_vecs : NULL, nr_vecs, opf);
 	bio->bi_pool = bs;
 	return bio;
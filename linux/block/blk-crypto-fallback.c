@@ -13,9 +13,12 @@
 #include <linux/blk-crypto.h>
 #include <linux/blk-crypto-profile.h>
 #include <linux/blkdev.h>
+#include <linux/cpuhotplug.h>
 #include <linux/crypto.h>
+#include <linux/local_lock.h>
 #include <linux/mempool.h>
 #include <linux/module.h>
+#include <linux/percpu.h>
 #include <linux/random.h>
 #include <linux/scatterlist.h>
 
@@ -83,6 +86,23 @@ static struct workqueue_struct *blk_crypto_wq;
 static mempool_t *blk_crypto_bounce_page_pool;
 static struct bio_set crypto_bio_split;
 
+/*
+ * Small per-cpu stash of bounce pages in front of blk_crypto_bounce_page_pool,
+ * so that a steady stream of writes doesn't go back to the page allocator for
+ * every page it encrypts.
+ */
+#define BLK_CRYPTO_BOUNCE_CACHE_PAGES	16
+
+struct blk_crypto_bounce_cache {
+	local_lock_t lock;
+	unsigned int nr;
+	struct page *pages[BLK_CRYPTO_BOUNCE_CACHE_PAGES];
+};
+
+static DEFINE_PER_CPU(struct blk_crypto_bounce_cache, blk_crypto_bounce_cache) = {
+	.lock = INIT_LOCAL_LOCK(lock),
+};
+
 /*
  * This is the key we set when evicting a keyslot. This *should* be the all 0's
  * key, but AES-XTS rejects that key, so we use some random bytes instead.
@@ -141,14 +161,69 @@ static const struct blk_crypto_ll_ops blk_crypto_fallback_ll_ops = {
 	.keyslot_evict          = blk_crypto_fallback_keyslot_evict,
 };
 
+static struct page *blk_crypto_fallback_alloc_bounce_page(void)
+{
+	struct blk_crypto_bounce_cache *cache;
+	struct page *page = NULL;
+	unsigned long flags;
+
+	local_lock_irqsave(&blk_crypto_bounce_cache.lock, flags);
+	cache = this_cpu_ptr(&blk_crypto_bounce_cache);
+	if (cache->nr)
+		page = cache->pages[--cache->nr];
+	local_unlock_irqrestore(&blk_crypto_bounce_cache.lock, flags);
+
+	if (!page)
+		page = mempool_alloc(blk_crypto_bounce_page_pool, GFP_NOIO);
+	return page;
+}
+
+static void blk_crypto_fallback_free_bounce_page(struct page *page)
+{
+	struct blk_crypto_bounce_cache *cache;
+	unsigned long flags;
+
+	/*
+	 * Pages sitting in the per-cpu caches don't help a writer that is
+	 * waiting on the mempool, so always top up its reserve first.
+	 */
+	if (READ_ONCE(blk_crypto_bounce_page_pool->curr_nr) <
+	    blk_crypto_bounce_page_pool->min_nr) {
+		mempool_free(page, blk_crypto_bounce_page_pool);
+		return;
+	}
+
+	local_lock_irqsave(&blk_crypto_bounce_cache.lock, flags);
+	cache = this_cpu_ptr(&blk_crypto_bounce_cache);
+	if (cache->nr < BLK_CRYPTO_BOUNCE_CACHE_PAGES) {
+		cache->pages[cache->nr++] = page;
+		page = NULL;
+	}
+	local_unlock_irqrestore(&blk_crypto_bounce_cache.lock, flags);
+
+	if (page)
+		mempool_free(page, blk_crypto_bounce_page_pool);
+}
+
+/* hand the stash of a CPU that went away back to the page allocator */
+static int blk_crypto_fallback_cpu_dead(unsigned int cpu)
+{
+	struct blk_crypto_bounce_cache *cache =
+		per_cpu_ptr(&blk_crypto_bounce_cache, cpu);
+
+	while (cache->nr)
+		__free_page(cache->pages[--cache->nr]);
+	return 0;
+}
+
 static void blk_crypto_fallback_encrypt_endio(struct bio *enc_bio)
 {
 	struct bio *src_bio = enc_bio->bi_private;
 	int i;
 
 	for (i = 0; i < enc_bio->bi_vcnt; i++)
-		mempool_free(enc_bio->bi_io_vec[i].bv_page,
-			     blk_crypto_bounce_page_pool);
+		blk_crypto_fallback_free_bounce_page(
+					enc_bio->bi_io_vec[i].bv_page);
 
 	src_bio->bi_status = enc_bio->bi_status;
 
@@ -319,7 +394,7 @@ static bool blk_crypto_fallback_encrypt_bio(struct bio **bio_ptr)
 		struct bio_vec *enc_bvec = &enc_bio->bi_io_vec[i];
 		struct page *plaintext_page = enc_bvec->bv_page;
 		struct page *ciphertext_page =
-			mempool_alloc(blk_crypto_bounce_page_pool, GFP_NOIO);
+			blk_crypto_fallback_alloc_bounce_page();
 
 		enc_bvec->bv_page = ciphertext_page;
 
@@ -358,8 +433,8 @@ static bool blk_crypto_fallback_encrypt_bio(struct bio **bio_ptr)
 
 out_free_bounce_pages:
 	while (i > 0)
-		mempool_free(enc_bio->bi_io_vec[--i].bv_page,
-			     blk_crypto_bounce_page_pool);
+		blk_crypto_fallback_free_bounce_page(
+					enc_bio->bi_io_vec[--i].bv_page);
 out_free_ciph_req:
 	skcipher_request_free(ciph_req);
 out_release_keyslot:
@@ -596,9 +671,17 @@ static int blk_crypto_fallback_init(void)
 	if (!bio_fallback_crypt_ctx_pool)
 		goto fail_free_crypt_ctx_cache;
 
+	err = cpuhp_setup_state_nocalls(CPUHP_BP_PREPARE_DYN,
+					"block/crypto-fallback:dead", NULL,
+					blk_crypto_fallback_cpu_dead);
+	if (err < 0)
+		goto fail_free_crypt_ctx_pool;
+
 	blk_crypto_fallback_inited = true;
 
 	return 0;
+fail_free_crypt_ctx_pool:
+	mempool_destroy(bio_fallback_crypt_ctx_pool);
 fail_free_crypt_ctx_cache:
 	kmem_cache_destroy(bio_fallback_crypt_ctx_cache);
 fail_free_bounce_page_pool:
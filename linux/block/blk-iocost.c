@@ -170,6 +170,9 @@
  * - inflt	: The percentage of in-flight IO cost at the end of last period
  * - del_ms	: Deferred issuer delay induction level and duration
  * - usages	: Usage history
+ *
+ * The CPU cost of the period timer itself is exported in the rqos debugfs
+ * directory of the device as "timer_cost".
  */
 
 #include <linux/kernel.h>
@@ -445,6 +448,13 @@ struct ioc {
 	int				autop_idx;
 	bool				user_qos_params:1;
 	bool				user_cost_model:1;
+
+	/* period timer cost, see ioc_timer_cost_show() */
+	u64				timer_last_ns;
+	u64				timer_max_ns;
+	u64				timer_total_ns;
+	u64				timer_nr_runs;
+	u32				timer_nr_active;
 };
 
 struct iocg_pcpu_stat {
@@ -2240,6 +2250,17 @@ static int ioc_check_iocgs(struct ioc *ioc, struct ioc_now *now)
 	return nr_debtors;
 }
 
+static void ioc_account_timer(struct ioc *ioc, u64 cost_ns, int nr_active)
+{
+	lockdep_assert_held(&ioc->lock);
+
+	ioc->timer_last_ns = cost_ns;
+	ioc->timer_max_ns = max(ioc->timer_max_ns, cost_ns);
+	ioc->timer_total_ns += cost_ns;
+	ioc->timer_nr_runs++;
+	ioc->timer_nr_active = nr_active;
+}
+
 static void ioc_timer_fn(struct timer_list *timer)
 {
 	struct ioc *ioc = container_of(timer, struct ioc, timer);
@@ -2253,6 +2274,8 @@ static void ioc_timer_fn(struct timer_list *timer)
 	u32 missed_ppm[2], rq_wait_pct;
 	u64 period_vtime;
 	int prev_busy_level;
+	int nr_active = 0;
+	u64 timer_start_ns = ktime_get_ns();
 
 	/* how were the latencies during the period? */
 	ioc_lat_stat(ioc, missed_ppm, &rq_wait_pct);
@@ -2283,6 +2306,8 @@ static void ioc_timer_fn(struct timer_list *timer)
 		u64 vdone, vtime, usage_us;
 		u32 hw_active, hw_inuse;
 
+		nr_active++;
+
 		/*
 		 * Collect unused and wind vtime closer to vnow to prevent
 		 * iocgs from accumulating a large amount of budget.
@@ -2463,6 +2488,8 @@ static void ioc_timer_fn(struct timer_list *timer)
 		ioc_refresh_vrate(ioc, &now);
 	}
 
+	ioc_account_timer(ioc, ktime_get_ns() - timer_start_ns, nr_active);
+
 	spin_unlock_irq(&ioc->lock);
 }
 
@@ -2870,6 +2897,33 @@ static void ioc_rqos_exit(struct rq_qos *rqos)
 	kfree(ioc);
 }
 
+#ifdef CONFIG_BLK_DEBUG_FS
+static int ioc_timer_cost_show(void *data, struct seq_file *m)
+{
+	struct ioc *ioc = rqos_to_ioc(data);
+	u64 last_ns, max_ns, total_ns, nr_runs;
+	u32 nr_active;
+
+	spin_lock_irq(&ioc->lock);
+	last_ns = ioc->timer_last_ns;
+	max_ns = ioc->timer_max_ns;
+	total_ns = ioc->timer_total_ns;
+	nr_runs = ioc->timer_nr_runs;
+	nr_active = ioc->timer_nr_active;
+	spin_unlock_irq(&ioc->lock);
+
+	seq_printf(m, "last_ns=%llu max_ns=%llu avg_ns=%llu nr_periods=%llu nr_active=%u\n",
+		   last_ns, max_ns, nr_runs ? div64_u64(total_ns, nr_runs) : 0,
+		   nr_runs, nr_active);
+	return 0;
+}
+
+static const struct blk_mq_debugfs_attr ioc_debugfs_attrs[] = {
+	{"timer_cost", 0400, ioc_timer_cost_show},
+	{},
+};
+#endif
+
 static const struct rq_qos_ops ioc_rqos_ops = {
 	.throttle = ioc_rqos_throttle,
 	.merge = ioc_rqos_merge,
@@ -2877,6 +2931,9 @@ static const struct rq_qos_ops ioc_rqos_ops = {
 	.done = ioc_rqos_done,
 	.queue_depth_changed = ioc_rqos_queue_depth_changed,
 	.exit = ioc_rqos_exit,
+#ifdef CONFIG_BLK_DEBUG_FS
+	.debugfs_attrs = ioc_debugfs_attrs,
+#endif
 };
 
 static int blk_iocost_init(struct gendisk *disk)
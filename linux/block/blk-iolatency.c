@@ -134,6 +134,7 @@ struct latency_stat {
 		struct percentile_stats ps;
 		struct blk_rq_stat rqs;
 	};
+	struct blk_rq_lat_hist hist;
 };
 
 struct iolatency_grp {
@@ -154,6 +155,11 @@ struct iolatency_grp {
 	/* Our current number of IO's for the last summation. */
 	u64 nr_samples;
 
+	/* latency percentiles of the last window with samples, in ns */
+	u64 lat_p50;
+	u64 lat_p90;
+	u64 lat_p99;
+
 	bool ssd;
 	struct child_latency_info child_lat;
 };
@@ -203,6 +209,7 @@ static inline void latency_stat_init(struct iolatency_grp *iolat,
 		stat->ps.missed = 0;
 	} else
 		blk_rq_stat_init(&stat->rqs);
+	blk_rq_lat_hist_init(&stat->hist);
 }
 
 static inline void latency_stat_sum(struct iolatency_grp *iolat,
@@ -214,6 +221,7 @@ static inline void latency_stat_sum(struct iolatency_grp *iolat,
 		sum->ps.missed += stat->ps.missed;
 	} else
 		blk_rq_stat_sum(&sum->rqs, &stat->rqs);
+	blk_rq_lat_hist_sum(&sum->hist, &stat->hist);
 }
 
 static inline void latency_stat_record_time(struct iolatency_grp *iolat,
@@ -226,6 +234,7 @@ static inline void latency_stat_record_time(struct iolatency_grp *iolat,
 		stat->ps.total++;
 	} else
 		blk_rq_stat_add(&stat->rqs, req_time);
+	blk_rq_lat_hist_add(&stat->hist, req_time);
 	put_cpu_ptr(stat);
 }
 
@@ -539,6 +548,12 @@ static void iolatency_check_latencies(struct iolatency_grp *iolat, u64 now)
 	}
 	preempt_enable();
 
+	if (blk_rq_lat_hist_samples(&stat.hist)) {
+		iolat->lat_p50 = blk_rq_lat_hist_percentile(&stat.hist, 50);
+		iolat->lat_p90 = blk_rq_lat_hist_percentile(&stat.hist, 90);
+		iolat->lat_p99 = blk_rq_lat_hist_percentile(&stat.hist, 99);
+	}
+
 	parent = blkg_to_lat(blkg->parent);
 	if (!parent)
 		return;
@@ -952,6 +967,11 @@ static void iolatency_pd_stat(struct blkg_policy_data *pd, struct seq_file *s)
 	if (!blkcg_debug_stats)
 		return;
 
+	seq_printf(s, " p50_lat=%llu p90_lat=%llu p99_lat=%llu",
+		   div64_u64(iolat->lat_p50, NSEC_PER_USEC),
+		   div64_u64(iolat->lat_p90, NSEC_PER_USEC),
+		   div64_u64(iolat->lat_p99, NSEC_PER_USEC));
+
 	if (iolat->ssd)
 		return iolatency_ssd_stat(iolat, s);
 
@@ -5,6 +5,7 @@
  * Copyright (C) 2016 Jens Axboe
  */
 #include <linux/kernel.h>
+#include <linux/log2.h>
 #include <linux/rculist.h>
 
 #include "blk-stat.h"
@@ -47,6 +48,84 @@ void blk_rq_stat_add(struct blk_rq_stat *stat, u64 value)
 	stat->nr_samples++;
 }
 
+static unsigned int blk_rq_lat_hist_index(u64 value)
+{
+	u64 v = value >> BLK_STAT_HIST_SHIFT;
+	unsigned int e;
+
+	if (v < BLK_STAT_HIST_SUB)
+		return v;
+
+	e = ilog2(v) - BLK_STAT_HIST_SUB_BITS;
+	if (e + 1 >= BLK_STAT_HIST_GROUPS)
+		return BLK_STAT_HIST_BUCKETS - 1;
+	return (e + 1) * BLK_STAT_HIST_SUB + (v >> e) - BLK_STAT_HIST_SUB;
+}
+
+/* Upper bound, in ns, of the values counted in histogram bucket @idx. */
+static u64 blk_rq_lat_hist_bound(unsigned int idx)
+{
+	unsigned int group = idx / BLK_STAT_HIST_SUB;
+	unsigned int sub = idx % BLK_STAT_HIST_SUB;
+
+	if (!group)
+		return (u64)(sub + 1) << BLK_STAT_HIST_SHIFT;
+	return (u64)(BLK_STAT_HIST_SUB + sub + 1) <<
+		(group - 1 + BLK_STAT_HIST_SHIFT);
+}
+
+void blk_rq_lat_hist_init(struct blk_rq_lat_hist *hist)
+{
+	memset(hist, 0, sizeof(*hist));
+}
+
+void blk_rq_lat_hist_add(struct blk_rq_lat_hist *hist, u64 value)
+{
+	hist->buckets[blk_rq_lat_hist_index(value)]++;
+}
+
+void blk_rq_lat_hist_sum(struct blk_rq_lat_hist *dst,
+			 struct blk_rq_lat_hist *src)
+{
+	unsigned int i;
+
+	for (i = 0; i < BLK_STAT_HIST_BUCKETS; i++)
+		dst->buckets[i] += src->buckets[i];
+}
+
+u64 blk_rq_lat_hist_samples(const struct blk_rq_lat_hist *hist)
+{
+	u64 nr = 0;
+	unsigned int i;
+
+	for (i = 0; i < BLK_STAT_HIST_BUCKETS; i++)
+		nr += hist->buckets[i];
+	return nr;
+}
+
+/*
+ * Return an upper bound, in ns, of the @pct percentile of the latencies
+ * counted in @hist, or 0 if @hist is empty.
+ */
+u64 blk_rq_lat_hist_percentile(const struct blk_rq_lat_hist *hist,
+			       unsigned int pct)
+{
+	u64 nr = blk_rq_lat_hist_samples(hist);
+	u64 target, seen = 0;
+	unsigned int i;
+
+	if (!nr)
+		return 0;
+
+	target = max_t(u64, DIV_ROUND_UP_ULL(nr * min(pct, 100U), 100), 1);
+	for (i = 0; i < BLK_STAT_HIST_BUCKETS - 1; i++) {
+		seen += hist->buckets[i];
+		if (seen >= target)
+			break;
+	}
+	return blk_rq_lat_hist_bound(i);
+}
+
 void blk_stat_add(struct request *rq, u64 now)
 {
 	struct request_queue *q = rq->q;
@@ -69,6 +148,9 @@ void blk_stat_add(struct request *rq, u64 now)
 
 		stat = &per_cpu_ptr(cb->cpu_stat, cpu)[bucket];
 		blk_rq_stat_add(stat, value);
+		if (cb->cpu_hist)
+			blk_rq_lat_hist_add(&per_cpu_ptr(cb->cpu_hist, cpu)[bucket],
+					    value);
 	}
 	put_cpu();
 	rcu_read_unlock();
@@ -93,6 +175,22 @@ static void blk_stat_timer_fn(struct timer_list *t)
 		}
 	}
 
+	if (cb->hist) {
+		for (bucket = 0; bucket < cb->buckets; bucket++)
+			blk_rq_lat_hist_init(&cb->hist[bucket]);
+
+		for_each_online_cpu(cpu) {
+			struct blk_rq_lat_hist *cpu_hist;
+
+			cpu_hist = per_cpu_ptr(cb->cpu_hist, cpu);
+			for (bucket = 0; bucket < cb->buckets; bucket++) {
+				blk_rq_lat_hist_sum(&cb->hist[bucket],
+						    &cpu_hist[bucket]);
+				blk_rq_lat_hist_init(&cpu_hist[bucket]);
+			}
+		}
+	}
+
 	cb->timer_fn(cb);
 }
 
@@ -125,11 +223,32 @@ blk_stat_alloc_callback(void (*timer_fn)(struct blk_stat_callback *),
 	cb->bucket_fn = bucket_fn;
 	cb->data = data;
 	cb->buckets = buckets;
+	cb->cpu_hist = NULL;
+	cb->hist = NULL;
 	timer_setup(&cb->timer, blk_stat_timer_fn, 0);
 
 	return cb;
 }
 
+int blk_stat_alloc_hist(struct blk_stat_callback *cb)
+{
+	cb->hist = kcalloc(cb->buckets, sizeof(struct blk_rq_lat_hist),
+			   GFP_KERNEL);
+	if (!cb->hist)
+		return -ENOMEM;
+
+	cb->cpu_hist = __alloc_percpu(cb->buckets *
+				      sizeof(struct blk_rq_lat_hist),
+				      __alignof__(struct blk_rq_lat_hist));
+	if (!cb->cpu_hist) {
+		kfree(cb->hist);
+		cb->hist = NULL;
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
 void blk_stat_add_callback(struct request_queue *q,
 			   struct blk_stat_callback *cb)
 {
@@ -143,6 +262,14 @@ void blk_stat_add_callback(struct request_queue *q,
 		cpu_stat = per_cpu_ptr(cb->cpu_stat, cpu);
 		for (bucket = 0; bucket < cb->buckets; bucket++)
 			blk_rq_stat_init(&cpu_stat[bucket]);
+
+		if (cb->cpu_hist) {
+			struct blk_rq_lat_hist *cpu_hist;
+
+			cpu_hist = per_cpu_ptr(cb->cpu_hist, cpu);
+			for (bucket = 0; bucket < cb->buckets; bucket++)
+				blk_rq_lat_hist_init(&cpu_hist[bucket]);
+		}
 	}
 
 	spin_lock_irqsave(&q->stats->lock, flags);
@@ -170,6 +297,8 @@ static void blk_stat_free_callback_rcu(struct rcu_head *head)
 	struct blk_stat_callback *cb;
 
 	cb = container_of(head, struct blk_stat_callback, rcu);
+	free_percpu(cb->cpu_hist);
+	kfree(cb->hist);
 	free_percpu(cb->cpu_stat);
 	kfree(cb->stat);
 	kfree(cb);
@@ -8,6 +8,23 @@
 #include <linux/rcupdate.h>
 #include <linux/timer.h>
 
+/*
+ * Log-linear latency histogram. Latencies are counted in units of
+ * 2^BLK_STAT_HIST_SHIFT ns (about 1us). Each power of two range of values
+ * is split into 2^BLK_STAT_HIST_SUB_BITS linear sub-buckets, which bounds
+ * the relative error of a percentile to 25%. Latencies above about 8s are
+ * all counted in the last bucket.
+ */
+#define BLK_STAT_HIST_SHIFT	10
+#define BLK_STAT_HIST_SUB_BITS	2
+#define BLK_STAT_HIST_SUB	(1U << BLK_STAT_HIST_SUB_BITS)
+#define BLK_STAT_HIST_GROUPS	22
+#define BLK_STAT_HIST_BUCKETS	(BLK_STAT_HIST_GROUPS * BLK_STAT_HIST_SUB)
+
+struct blk_rq_lat_hist {
+	u32 buckets[BLK_STAT_HIST_BUCKETS];
+};
+
 /**
  * struct blk_stat_callback - Block statistics callback.
  *
@@ -49,6 +66,18 @@ struct blk_stat_callback {
 	 */
 	struct blk_rq_stat *stat;
 
+	/**
+	 * @cpu_hist: Per-cpu latency histograms, one per statistics bucket.
+	 * Only allocated by blk_stat_alloc_hist().
+	 */
+	struct blk_rq_lat_hist __percpu *cpu_hist;
+
+	/**
+	 * @hist: Array of latency histograms, flushed from @cpu_hist along
+	 * with @stat. Only allocated by blk_stat_alloc_hist().
+	 */
+	struct blk_rq_lat_hist *hist;
+
 	/**
 	 * @fn: Callback function.
 	 */
@@ -87,6 +116,17 @@ blk_stat_alloc_callback(void (*timer_fn)(struct blk_stat_callback *),
 			int (*bucket_fn)(const struct request *),
 			unsigned int buckets, void *data);
 
+/**
+ * blk_stat_alloc_hist() - Also gather latency histograms for a block
+ * statistics callback.
+ * @cb: The callback.
+ *
+ * Must be called before @cb is added to a request queue.
+ *
+ * Return: 0 on success or -ENOMEM.
+ */
+int blk_stat_alloc_hist(struct blk_stat_callback *cb);
+
 /**
  * blk_stat_add_callback() - Add a block statistics callback to be run on a
  * request queue.
@@ -169,4 +209,11 @@ void blk_rq_stat_add(struct blk_rq_stat *, u64);
 void blk_rq_stat_sum(struct blk_rq_stat *, struct blk_rq_stat *);
 void blk_rq_stat_init(struct blk_rq_stat *);
 
+void blk_rq_lat_hist_add(struct blk_rq_lat_hist *, u64);
+void blk_rq_lat_hist_sum(struct blk_rq_lat_hist *, struct blk_rq_lat_hist *);
+void blk_rq_lat_hist_init(struct blk_rq_lat_hist *);
+u64 blk_rq_lat_hist_samples(const struct blk_rq_lat_hist *);
+u64 blk_rq_lat_hist_percentile(const struct blk_rq_lat_hist *,
+			       unsigned int pct);
+
 #endif
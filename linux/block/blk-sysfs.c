@@ -657,6 +657,55 @@ out:
 }
 
 QUEUE_RW_ENTRY(queue_wb_lat, "wbt_lat_usec");
+
+static ssize_t queue_wb_mode_show(struct gendisk *disk, char *page)
+{
+	ssize_t ret;
+	struct request_queue *q = disk->queue;
+
+	/* until wbt is set up, report the mode it will start in */
+	mutex_lock(&disk->rqos_state_mutex);
+	if (wbt_get_mode(q) == WBT_MODE_P99)
+		ret = sysfs_emit(page, "p99\n");
+	else
+		ret = sysfs_emit(page, "min_lat\n");
+	mutex_unlock(&disk->rqos_state_mutex);
+	return ret;
+}
+
+static ssize_t queue_wb_mode_store(struct gendisk *disk, const char *page,
+				   size_t count)
+{
+	struct request_queue *q = disk->queue;
+	enum wbt_mode mode;
+	unsigned int memflags;
+	int ret;
+
+	if (sysfs_streq(page, "min_lat"))
+		mode = WBT_MODE_MIN_LAT;
+	else if (sysfs_streq(page, "p99"))
+		mode = WBT_MODE_P99;
+	else
+		return -EINVAL;
+
+	memflags = blk_mq_freeze_queue(q);
+
+	if (!wbt_rq_qos(q)) {
+		ret = wbt_init(disk);
+		if (ret)
+			goto out;
+	}
+
+	mutex_lock(&disk->rqos_state_mutex);
+	ret = wbt_set_mode(q, mode);
+	mutex_unlock(&disk->rqos_state_mutex);
+out:
+	blk_mq_unfreeze_queue(q, memflags);
+
+	return ret ? ret : count;
+}
+
+QUEUE_RW_ENTRY(queue_wb_mode, "wbt_mode");
 #endif
 
 /* Common attributes for bio-based and request-based queues. */
@@ -728,6 +777,7 @@ static struct attribute *blk_mq_queue_attrs[] = {
 	&queue_requests_entry.attr,
 #ifdef CONFIG_BLK_WBT
 	&queue_wb_lat_entry.attr,
+	&queue_wb_mode_entry.attr,
 #endif
 	/*
 	 * Attributes which don't require locking.
@@ -1194,6 +1194,24 @@ out_unlock:
 	spin_unlock_irq(&q->queue_lock);
 }
 
+static void throtl_record_latency(struct bio *bio, u64 now)
+{
+	struct throtl_grp *tg = blkg_to_tg(bio->bi_blkg);
+	u64 start = bio_issue_time(&bio->bi_issue);
+	u64 lat_ms = 0, lat_ns = 0;
+	int bucket = 0;
+
+	if (now > start) {
+		lat_ns = now - start;
+		lat_ms = div_u64(lat_ns, NSEC_PER_MSEC);
+	}
+	if (lat_ms)
+		bucket = min(ilog2(lat_ms) / 2 + 1, THROTL_LAT_BUCKETS - 1);
+
+	tg->lat_hist[bucket]++;
+	tg->lat_total_us += div_u64(lat_ns, NSEC_PER_USEC);
+}
+
 /**
  * blk_throtl_dispatch_work_fn - work function for throtl_data->dispatch_work
  * @work: work item being executed
@@ -1211,14 +1229,19 @@ static void blk_throtl_dispatch_work_fn(struct work_struct *work)
 	struct bio_list bio_list_on_stack;
 	struct bio *bio;
 	struct blk_plug plug;
+	u64 now;
 	int rw;
 
 	bio_list_init(&bio_list_on_stack);
 
 	spin_lock_irq(&q->queue_lock);
-	for (rw = READ; rw <= WRITE; rw++)
-		while ((bio = throtl_pop_queued(td_sq, NULL, rw)))
+	now = __bio_issue_time(blk_time_get_ns());
+	for (rw = READ; rw <= WRITE; rw++) {
+		while ((bio = throtl_pop_queued(td_sq, NULL, rw))) {
+			throtl_record_latency(bio, now);
 			bio_list_add(&bio_list_on_stack, bio);
+		}
+	}
 	spin_unlock_irq(&q->queue_lock);
 
 	if (!bio_list_empty(&bio_list_on_stack)) {
@@ -1678,6 +1701,27 @@ static void throtl_pd_offline(struct blkg_policy_data *pd)
 	tg_flush_bios(pd_to_tg(pd));
 }
 
+static void throtl_pd_stat(struct blkg_policy_data *pd, struct seq_file *s)
+{
+	static const char * const lat_names[THROTL_LAT_BUCKETS] = {
+		"1ms", "4ms", "16ms", "64ms", "256ms", "1s", "4s", "inf",
+	};
+	struct throtl_grp *tg = pd_to_tg(pd);
+	u64 nr_throttled = 0;
+	int i;
+
+	for (i = 0; i < THROTL_LAT_BUCKETS; i++)
+		nr_throttled += tg->lat_hist[i];
+	if (!nr_throttled)
+		return;
+
+	seq_printf(s, " throttle.nr=%llu throttle.lat_avg_us=%llu",
+		   nr_throttled, div64_u64(tg->lat_total_us, nr_throttled));
+	for (i = 0; i < THROTL_LAT_BUCKETS; i++)
+		seq_printf(s, " throttle.lat_lt_%s=%llu", lat_names[i],
+			   tg->lat_hist[i]);
+}
+
 struct blkcg_policy blkcg_policy_throtl = {
 	.dfl_cftypes		= throtl_files,
 	.legacy_cftypes		= throtl_legacy_files,
@@ -1687,6 +1731,7 @@ struct blkcg_policy blkcg_policy_throtl = {
 	.pd_online_fn		= throtl_pd_online,
 	.pd_offline_fn		= throtl_pd_offline,
 	.pd_free_fn		= throtl_pd_free,
+	.pd_stat_fn		= throtl_pd_stat,
 };
 
 void blk_throtl_cancel_bios(struct gendisk *disk)
@@ -1819,6 +1864,11 @@ bool __blk_throtl_bio(struct bio *bio)
 		   sq_queued(sq, READ), sq_queued(sq, WRITE));
 
 	td->nr_queued[rw]++;
+	/*
+	 * Stamp the time @bio got throttled for the latency histogram,
+	 * bi_issue is initialized again once @bio gets issued.
+	 */
+	bio_issue_init(&bio->bi_issue, bio_sectors(bio));
 	throtl_add_bio_tg(bio, qn, tg);
 	throttled = true;
 
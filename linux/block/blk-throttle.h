@@ -66,6 +66,13 @@ enum tg_state_flags {
 	THROTL_TG_CANCELING		= 1 << 3,	/* starts to cancel bio */
 };
 
+/*
+ * Buckets of the throttled latency histogram. Bucket i counts the bios which
+ * were held back for less than 4^i ms (and at least 4^(i - 1) ms if i > 0),
+ * the last bucket counts all the longer ones.
+ */
+#define THROTL_LAT_BUCKETS	8
+
 struct throtl_grp {
 	/* must be the first member */
 	struct blkg_policy_data pd;
@@ -128,6 +135,10 @@ struct throtl_grp {
 
 	struct blkg_rwstat stat_bytes;
 	struct blkg_rwstat stat_ios;
+
+	/* time spent queued by bios that got throttled, protected by queue_lock */
+	u64 lat_hist[THROTL_LAT_BUCKETS];
+	u64 lat_total_us;
 };
 
 extern struct blkcg_policy blkcg_policy_throtl;
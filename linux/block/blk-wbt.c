@@ -16,6 +16,13 @@
  *   positive scaling steps where we shrink the monitoring window, a negative
  *   scaling step retains the default step==0 window size.
  *
+ * In WBT_MODE_P99, the minimum latency check is replaced by a closed loop
+ * on the read p99 latency of each window, taken from the blk-stat latency
+ * histograms. The depth is scaled down while the read p99 exceeds the
+ * target and writes make up a meaningful share of the completions, held
+ * while it is close to the target, and scaled up once it is comfortably
+ * below it.
+ *
  * Copyright (C) 2016 Jens Axboe
  *
  */
@@ -88,6 +95,11 @@ struct rq_wb {
 	unsigned long last_issue;	/* issue time of last read rq */
 	unsigned long last_comp;	/* completion time of last read rq */
 	unsigned long min_lat_nsec;
+
+	enum wbt_mode mode;
+	u64 read_p99;			/* last window read p99, WBT_MODE_P99 */
+	u64 write_p99;			/* last window write p99, WBT_MODE_P99 */
+
 	struct rq_qos rqos;
 	struct rq_wait rq_wait[WBT_NUM_RWQ];
 	struct rq_depth rq_depth;
@@ -141,6 +153,13 @@ enum {
 	 * (step == 0).
 	 */
 	RWB_UNKNOWN_BUMP	= 5,
+
+	/*
+	 * In WBT_MODE_P99, there must be at least RWB_PCT_WRITE_SHARE write
+	 * completions per 100 read completions before we throttle writes for
+	 * missed read latencies. Below that, the reads are slow on their own.
+	 */
+	RWB_PCT_WRITE_SHARE	= 8,
 };
 
 static inline bool rwb_enabled(struct rq_wb *rwb)
@@ -300,12 +319,49 @@ enum {
 	LAT_UNKNOWN,
 	LAT_UNKNOWN_WRITES,
 	LAT_EXCEEDED,
+	LAT_STEADY,
 };
 
-static int latency_exceeded(struct rq_wb *rwb, struct blk_rq_stat *stat)
+static int latency_pct_exceeded(struct rq_wb *rwb,
+				struct blk_stat_callback *cb)
+{
+	struct backing_dev_info *bdi = rwb->rqos.disk->bdi;
+	struct blk_rq_stat *stat = cb->stat;
+	u64 target = rwb->min_lat_nsec;
+
+	rwb->read_p99 = blk_rq_lat_hist_percentile(&cb->hist[READ], 99);
+	rwb->write_p99 = blk_rq_lat_hist_percentile(&cb->hist[WRITE], 99);
+
+	trace_wbt_pct(bdi, blk_rq_lat_hist_percentile(&cb->hist[READ], 50),
+		      rwb->read_p99, rwb->write_p99, target,
+		      stat[READ].nr_samples, stat[WRITE].nr_samples);
+
+	if (rwb->read_p99 > target) {
+		/*
+		 * Throttling writeback only helps if writes are a real part
+		 * of what the device is busy with.
+		 */
+		if (stat[WRITE].nr_samples * 100 <
+		    stat[READ].nr_samples * RWB_PCT_WRITE_SHARE)
+			return LAT_STEADY;
+		return LAT_EXCEEDED;
+	}
+
+	/*
+	 * The histogram buckets are up to 25% wide, keep that much headroom
+	 * before handing more depth back to writeback.
+	 */
+	if (rwb->read_p99 > target - (target >> 2))
+		return LAT_STEADY;
+
+	return LAT_OK;
+}
+
+static int latency_exceeded(struct rq_wb *rwb, struct blk_stat_callback *cb)
 {
 	struct backing_dev_info *bdi = rwb->rqos.disk->bdi;
 	struct rq_depth *rqd = &rwb->rq_depth;
+	struct blk_rq_stat *stat = cb->stat;
 	u64 thislat;
 
 	/*
@@ -340,6 +396,9 @@ static int latency_exceeded(struct rq_wb *rwb, struct blk_rq_stat *stat)
 		return LAT_UNKNOWN;
 	}
 
+	if (rwb->mode == WBT_MODE_P99)
+		return latency_pct_exceeded(rwb, cb);
+
 	/*
 	 * If the 'min' latency exceeds our target, step down.
 	 */
@@ -430,7 +489,7 @@ static void wb_timer_fn(struct blk_stat_callback *cb)
 	if (!rwb->rqos.disk)
 		return;
 
-	status = latency_exceeded(rwb, cb->stat);
+	status = latency_exceeded(rwb, cb);
 
 	trace_wbt_timer(rwb->rqos.disk->bdi, status, rqd->scale_step, inflight);
 
@@ -467,6 +526,13 @@ static void wb_timer_fn(struct blk_stat_callback *cb)
 		else if (rqd->scale_step < 0)
 			scale_down(rwb, false);
 		break;
+	case LAT_STEADY:
+		/*
+		 * Percentile mode and close to the target, or missing it
+		 * without writes to blame. Keep the current depth.
+		 */
+		rwb->unknown_cnt = 0;
+		break;
 	default:
 		break;
 	}
@@ -521,6 +587,47 @@ void wbt_set_min_lat(struct request_queue *q, u64 val)
 	wbt_update_limits(RQWB(rqos));
 }
 
+enum wbt_mode wbt_get_mode(struct request_queue *q)
+{
+	struct rq_qos *rqos = wbt_rq_qos(q);
+	if (!rqos)
+		return WBT_MODE_MIN_LAT;
+	return RQWB(rqos)->mode;
+}
+
+/*
+ * Must be called with the queue frozen, as switching to WBT_MODE_P99 may
+ * have to attach latency histograms to the stats callback.
+ */
+int wbt_set_mode(struct request_queue *q, enum wbt_mode mode)
+{
+	struct rq_qos *rqos = wbt_rq_qos(q);
+	struct rq_wb *rwb;
+	int ret;
+
+	if (!rqos)
+		return -EINVAL;
+	rwb = RQWB(rqos);
+
+	/*
+	 * The histograms can only be allocated while the callback is off
+	 * the queue. With the queue frozen, no completion can be accounting
+	 * into it, so just take it off and add it back.
+	 */
+	if (mode == WBT_MODE_P99 && !rwb->cb->hist) {
+		blk_stat_remove_callback(q, rwb->cb);
+		ret = blk_stat_alloc_hist(rwb->cb);
+		blk_stat_add_callback(q, rwb->cb);
+		if (ret)
+			return ret;
+	}
+
+	rwb->mode = mode;
+	rwb->read_p99 = rwb->write_p99 = 0;
+	wbt_update_limits(rwb);
+	return 0;
+}
+
 
 static bool close_io(struct rq_wb *rwb)
 {
@@ -863,6 +970,33 @@ static int wbt_background_show(void *data, struct seq_file *m)
 	return 0;
 }
 
+static int wbt_mode_show(void *data, struct seq_file *m)
+{
+	struct rq_qos *rqos = data;
+	struct rq_wb *rwb = RQWB(rqos);
+
+	seq_printf(m, "%d\n", rwb->mode);
+	return 0;
+}
+
+static int wbt_read_p99_nsec_show(void *data, struct seq_file *m)
+{
+	struct rq_qos *rqos = data;
+	struct rq_wb *rwb = RQWB(rqos);
+
+	seq_printf(m, "%llu\n", rwb->read_p99);
+	return 0;
+}
+
+static int wbt_write_p99_nsec_show(void *data, struct seq_file *m)
+{
+	struct rq_qos *rqos = data;
+	struct rq_wb *rwb = RQWB(rqos);
+
+	seq_printf(m, "%llu\n", rwb->write_p99);
+	return 0;
+}
+
 static const struct blk_mq_debugfs_attr wbt_debugfs_attrs[] = {
 	{"curr_win_nsec", 0400, wbt_curr_win_nsec_show},
 	{"enabled", 0400, wbt_enabled_show},
@@ -872,6 +1006,9 @@ static const struct blk_mq_debugfs_attr wbt_debugfs_attrs[] = {
 	{"unknown_cnt", 0400, wbt_unknown_cnt_show},
 	{"wb_normal", 0400, wbt_normal_show},
 	{"wb_background", 0400, wbt_background_show},
+	{"mode", 0400, wbt_mode_show},
+	{"read_p99_nsec", 0400, wbt_read_p99_nsec_show},
+	{"write_p99_nsec", 0400, wbt_write_p99_nsec_show},
 	{},
 };
 #endif
@@ -4,6 +4,11 @@
 
 #ifdef CONFIG_BLK_WBT
 
+enum wbt_mode {
+	WBT_MODE_MIN_LAT,	/* scale on the minimum read latency */
+	WBT_MODE_P99,		/* scale on the read p99 latency */
+};
+
 int wbt_init(struct gendisk *disk);
 void wbt_disable_default(struct gendisk *disk);
 void wbt_enable_default(struct gendisk *disk);
@@ -11,6 +16,8 @@ void wbt_enable_default(struct gendisk *disk);
 u64 wbt_get_min_lat(struct request_queue *q);
 void wbt_set_min_lat(struct request_queue *q, u64 val);
 bool wbt_disabled(struct request_queue *);
+enum wbt_mode wbt_get_mode(struct request_queue *q);
+int wbt_set_mode(struct request_queue *q, enum wbt_mode mode);
 
 u64 wbt_default_latency_nsec(struct request_queue *);
 
@@ -55,6 +55,9 @@ static const char *const zone_cond_name[] = {
  *             as a number of 512B sectors.
  * @bio_list: The list of BIOs that are currently plugged.
  * @bio_work: Work struct to handle issuing of plugged BIOs
+ * @nr_plugged: Number of BIOs that were added to @bio_list.
+ * @nr_merged: Number of plugged BIOs that were merged into a request.
+ * @nr_work_issued: Number of plugged BIOs issued from @bio_work.
  * @rcu_head: RCU head to free zone write plugs with an RCU grace period.
  * @disk: The gendisk the plug belongs to.
  */
@@ -67,6 +70,9 @@ struct blk_zone_wplug {
 	unsigned int		wp_offset;
 	struct bio_list		bio_list;
 	struct work_struct	bio_work;
+	unsigned long		nr_plugged;
+	unsigned long		nr_merged;
+	unsigned long		nr_work_issued;
 	struct rcu_head		rcu_head;
 	struct gendisk		*disk;
 };
@@ -574,6 +580,9 @@ again:
 	zwplug->wp_offset = bdev_offset_from_zone_start(disk->part0, sector);
 	bio_list_init(&zwplug->bio_list);
 	INIT_WORK(&zwplug->bio_work, blk_zone_wplug_bio_work);
+	zwplug->nr_plugged = 0;
+	zwplug->nr_merged = 0;
+	zwplug->nr_work_issued = 0;
 	zwplug->disk = disk;
 
 	spin_lock_irqsave(&zwplug->lock, *flags);
@@ -822,6 +831,7 @@ static inline void disk_zone_wplug_add_bio(struct gendisk *disk,
 	 * at the tail of the list to preserve the sequential write order.
 	 */
 	bio_list_add(&zwplug->bio_list, bio);
+	zwplug->nr_plugged++;
 	trace_disk_zone_wplug_add_bio(zwplug->disk->queue, zwplug->zone_no,
 				      bio->bi_iter.bi_sector, bio_sectors(bio));
 
@@ -922,6 +932,7 @@ void blk_zone_write_plug_init_request(struct request *req)
 		/* Drop the reference taken by disk_zone_wplug_add_bio(). */
 		blk_queue_exit(q);
 		zwplug->wp_offset += bio_sectors(bio);
+		zwplug->nr_merged++;
 
 		req_back_sector += bio_sectors(bio);
 	}
@@ -1305,6 +1316,8 @@ again:
 				 bio->bi_iter.bi_sector, bio_sectors(bio));
 
 	prepared = blk_zone_wplug_prepare_bio(zwplug, bio);
+	if (prepared)
+		zwplug->nr_work_issued++;
 	spin_unlock_irqrestore(&zwplug->lock, flags);
 
 	if (!prepared) {
@@ -1851,6 +1864,7 @@ static void queue_zone_wplug_show(struct blk_zone_wplug *zwplug,
 	unsigned int zwp_wp_offset, zwp_flags;
 	unsigned int zwp_zone_no, zwp_ref;
 	unsigned int zwp_bio_list_size;
+	unsigned long zwp_nr_plugged, zwp_nr_merged, zwp_nr_work_issued;
 	unsigned long flags;
 
 	spin_lock_irqsave(&zwplug->lock, flags);
@@ -1859,10 +1873,14 @@ static void queue_zone_wplug_show(struct blk_zone_wplug *zwplug,
 	zwp_ref = refcount_read(&zwplug->ref);
 	zwp_wp_offset = zwplug->wp_offset;
 	zwp_bio_list_size = bio_list_size(&zwplug->bio_list);
+	zwp_nr_plugged = zwplug->nr_plugged;
+	zwp_nr_merged = zwplug->nr_merged;
+	zwp_nr_work_issued = zwplug->nr_work_issued;
 	spin_unlock_irqrestore(&zwplug->lock, flags);
 
-	seq_printf(m, "%u 0x%x %u %u %u\n", zwp_zone_no, zwp_flags, zwp_ref,
-		   zwp_wp_offset, zwp_bio_list_size);
+	seq_printf(m, "%u 0x%x %u %u %u %lu %lu %lu\n", zwp_zone_no, zwp_flags,
+		   zwp_ref, zwp_wp_offset, zwp_bio_list_size, zwp_nr_plugged,
+		   zwp_nr_merged, zwp_nr_work_issued);
 }
 
 int queue_zone_wplugs_show(void *data, struct seq_file *m)
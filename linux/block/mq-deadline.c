@@ -15,6 +15,7 @@
 #include <linux/compiler.h>
 #include <linux/rbtree.h>
 #include <linux/sbitmap.h>
+#include <linux/llist.h>
 
 #include <trace/events/block.h>
 
@@ -102,6 +103,16 @@ struct deadline_data {
 	int prio_aging_expire;
 
 	spinlock_t lock;
+
+	/*
+	 * Requests inserted by dd_insert_requests() are staged on these
+	 * lock-free lists, linked through rq->ipi_list, and are moved into
+	 * the per priority data structures under dd->lock by the next
+	 * dispatch or bio merge attempt. This keeps the submission path off
+	 * dd->lock, which is otherwise contended by every hardware queue.
+	 */
+	struct llist_head insert_head ____cacheline_aligned_in_smp;
+	struct llist_head insert_tail;
 };
 
 /* Maps an I/O priority class to a deadline scheduler priority. */
@@ -451,6 +462,74 @@ static struct request *dd_dispatch_prio_aged_requests(struct deadline_data *dd,
 	return NULL;
 }
 
+/*
+ * add rq to rbtree and fifo
+ */
+static void dd_insert_request(struct request_queue *q, struct request *rq,
+			      blk_insert_t flags, struct list_head *free)
+{
+	struct deadline_data *dd = q->elevator->elevator_data;
+	const enum dd_data_dir data_dir = rq_data_dir(rq);
+	u16 ioprio = req_get_ioprio(rq);
+	u8 ioprio_class = IOPRIO_PRIO_CLASS(ioprio);
+	struct dd_per_prio *per_prio;
+	enum dd_prio prio;
+
+	lockdep_assert_held(&dd->lock);
+
+	prio = ioprio_class_to_prio[ioprio_class];
+	per_prio = &dd->per_prio[prio];
+	if (!rq->elv.priv[0])
+		per_prio->stats.inserted++;
+	rq->elv.priv[0] = per_prio;
+
+	if (blk_mq_sched_try_insert_merge(q, rq, free))
+		return;
+
+	trace_block_rq_insert(rq);
+
+	if (flags & BLK_MQ_INSERT_AT_HEAD) {
+		list_add(&rq->queuelist, &per_prio->dispatch);
+		rq->fifo_time = jiffies;
+	} else {
+		deadline_add_rq_rb(per_prio, rq);
+
+		if (rq_mergeable(rq)) {
+			elv_rqhash_add(q, rq);
+			if (!q->last_merge)
+				q->last_merge = rq;
+		}
+
+		/*
+		 * add to fifo list, the expire time was set when the request
+		 * was staged by dd_insert_requests()
+		 */
+		list_add_tail(&rq->queuelist, &per_prio->fifo_list[data_dir]);
+	}
+}
+
+/*
+ * Move the requests staged by dd_insert_requests() into the sort and fifo
+ * lists, in the order in which they were inserted. Requests that got merged
+ * into another request are added to @free.
+ */
+static void dd_insert_staged(struct request_queue *q, struct list_head *free)
+{
+	struct deadline_data *dd = q->elevator->elevator_data;
+	struct llist_node *node;
+	struct request *rq, *next;
+
+	lockdep_assert_held(&dd->lock);
+
+	node = llist_reverse_order(llist_del_all(&dd->insert_head));
+	llist_for_each_entry_safe(rq, next, node, ipi_list)
+		dd_insert_request(q, rq, BLK_MQ_INSERT_AT_HEAD, free);
+
+	node = llist_reverse_order(llist_del_all(&dd->insert_tail));
+	llist_for_each_entry_safe(rq, next, node, ipi_list)
+		dd_insert_request(q, rq, 0, free);
+}
+
 /*
  * Called from blk_mq_run_hw_queue() -> __blk_mq_sched_dispatch_requests().
  *
@@ -465,8 +544,11 @@ static struct request *dd_dispatch_request(struct blk_mq_hw_ctx *hctx)
 	const unsigned long now = jiffies;
 	struct request *rq;
 	enum dd_prio prio;
+	LIST_HEAD(free);
 
 	spin_lock(&dd->lock);
+	dd_insert_staged(hctx->queue, &free);
+
 	rq = dd_dispatch_prio_aged_requests(dd, now);
 	if (rq)
 		goto unlock;
@@ -484,6 +566,8 @@ static struct request *dd_dispatch_request(struct blk_mq_hw_ctx *hctx)
 unlock:
 	spin_unlock(&dd->lock);
 
+	blk_mq_free_requests(&free);
+
 	return rq;
 }
 
@@ -530,6 +614,9 @@ static void dd_exit_sched(struct elevator_queue *e)
 	struct deadline_data *dd = e->elevator_data;
 	enum dd_prio prio;
 
+	WARN_ON_ONCE(!llist_empty(&dd->insert_head));
+	WARN_ON_ONCE(!llist_empty(&dd->insert_tail));
+
 	for (prio = 0; prio <= DD_PRIO_MAX; prio++) {
 		struct dd_per_prio *per_prio = &dd->per_prio[prio];
 		const struct io_stats_per_prio *stats = &per_prio->stats;
@@ -582,6 +669,8 @@ static int dd_init_sched(struct request_queue *q, struct elevator_queue *eq)
 	dd->fifo_batch = fifo_batch;
 	dd->prio_aging_expire = prio_aging_expire;
 	spin_lock_init(&dd->lock);
+	init_llist_head(&dd->insert_head);
+	init_llist_head(&dd->insert_tail);
 
 	/* We dispatch from request queue wide instead of hw queue */
 	blk_queue_flag_set(QUEUE_FLAG_SQ_SCHED, q);
@@ -631,65 +720,22 @@ static bool dd_bio_merge(struct request_queue *q, struct bio *bio,
 {
 	struct deadline_data *dd = q->elevator->elevator_data;
 	struct request *free = NULL;
+	LIST_HEAD(free_list);
 	bool ret;
 
 	spin_lock(&dd->lock);
+	/* Make recently inserted requests visible as merge candidates. */
+	dd_insert_staged(q, &free_list);
 	ret = blk_mq_sched_try_merge(q, bio, nr_segs, &free);
 	spin_unlock(&dd->lock);
 
 	if (free)
 		blk_mq_free_request(free);
+	blk_mq_free_requests(&free_list);
 
 	return ret;
 }
 
-/*
- * add rq to rbtree and fifo
- */
-static void dd_insert_request(struct blk_mq_hw_ctx *hctx, struct request *rq,
-			      blk_insert_t flags, struct list_head *free)
-{
-	struct request_queue *q = hctx->queue;
-	struct deadline_data *dd = q->elevator->elevator_data;
-	const enum dd_data_dir data_dir = rq_data_dir(rq);
-	u16 ioprio = req_get_ioprio(rq);
-	u8 ioprio_class = IOPRIO_PRIO_CLASS(ioprio);
-	struct dd_per_prio *per_prio;
-	enum dd_prio prio;
-
-	lockdep_assert_held(&dd->lock);
-
-	prio = ioprio_class_to_prio[ioprio_class];
-	per_prio = &dd->per_prio[prio];
-	if (!rq->elv.priv[0])
-		per_prio->stats.inserted++;
-	rq->elv.priv[0] = per_prio;
-
-	if (blk_mq_sched_try_insert_merge(q, rq, free))
-		return;
-
-	trace_block_rq_insert(rq);
-
-	if (flags & BLK_MQ_INSERT_AT_HEAD) {
-		list_add(&rq->queuelist, &per_prio->dispatch);
-		rq->fifo_time = jiffies;
-	} else {
-		deadline_add_rq_rb(per_prio, rq);
-
-		if (rq_mergeable(rq)) {
-			elv_rqhash_add(q, rq);
-			if (!q->last_merge)
-				q->last_merge = rq;
-		}
-
-		/*
-		 * set expire time and add to fifo list
-		 */
-		rq->fifo_time = jiffies + dd->fifo_expire[data_dir];
-		list_add_tail(&rq->queuelist, &per_prio->fifo_list[data_dir]);
-	}
-}
-
 /*
  * Called from blk_mq_insert_request() or blk_mq_dispatch_list().
  */
@@ -697,21 +743,25 @@ static void dd_insert_requests(struct blk_mq_hw_ctx *hctx,
 			       struct list_head *list,
 			       blk_insert_t flags)
 {
-	struct request_queue *q = hctx->queue;
-	struct deadline_data *dd = q->elevator->elevator_data;
-	LIST_HEAD(free);
+	struct deadline_data *dd = hctx->queue->elevator->elevator_data;
 
-	spin_lock(&dd->lock);
 	while (!list_empty(list)) {
 		struct request *rq;
 
 		rq = list_first_entry(list, struct request, queuelist);
 		list_del_init(&rq->queuelist);
-		dd_insert_request(hctx, rq, flags, &free);
-	}
-	spin_unlock(&dd->lock);
 
-	blk_mq_free_requests(&free);
+		/*
+		 * Staged requests are not on the merge hash yet, so the
+		 * ipi_list member that shares storage with rq->hash is free.
+		 */
+		if (flags & BLK_MQ_INSERT_AT_HEAD) {
+			llist_add(&rq->ipi_list, &dd->insert_head);
+		} else {
+			rq->fifo_time = jiffies + dd->fifo_expire[rq_data_dir(rq)];
+			llist_add(&rq->ipi_list, &dd->insert_tail);
+		}
+	}
 }
 
 /* Callback from inside blk_mq_rq_ctx_init(). */
@@ -748,6 +798,9 @@ static bool dd_has_work(struct blk_mq_hw_ctx *hctx)
 	struct deadline_data *dd = hctx->queue->elevator->elevator_data;
 	enum dd_prio prio;
 
+	if (!llist_empty(&dd->insert_head) || !llist_empty(&dd->insert_tail))
+		return true;
+
 	for (prio = 0; prio <= DD_PRIO_MAX; prio++)
 		if (dd_has_work_for_prio(&dd->per_prio[prio]))
 			return true;
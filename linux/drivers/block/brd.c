@@ -15,6 +15,7 @@
 #include <linux/moduleparam.h>
 #include <linux/major.h>
 #include <linux/blkdev.h>
+#include <linux/blk-mq.h>
 #include <linux/bio.h>
 #include <linux/highmem.h>
 #include <linux/mutex.h>
@@ -27,9 +28,13 @@
 
 #include <linux/uaccess.h>
 
+#define BRD_HW_QUEUE_DEPTH	128
+
 /*
- * Each block ramdisk device has a xarray brd_pages of pages that stores
- * the pages containing the block device's contents.
+ * Each block ramdisk device has a xarray brd_pages of folios that stores
+ * the folios containing the block device's contents.  All folios of a device
+ * have the same order, so the xarray index of a sector is simply the sector
+ * shifted by the folio size.
  */
 struct brd_device {
 	int			brd_number;
@@ -37,65 +42,79 @@ struct brd_device {
 	struct list_head	brd_list;
 
 	/*
-	 * Backing store of pages. This is the contents of the block device.
+	 * Backing store of folios. This is the contents of the block device.
 	 */
 	struct xarray	        brd_pages;
 	u64			brd_nr_pages;
+	unsigned int		brd_order;
+
+	/* Only used when the device is exposed through blk-mq. */
+	struct blk_mq_tag_set	brd_tag_set;
 };
 
+static inline unsigned int brd_folio_shift(struct brd_device *brd)
+{
+	return PAGE_SECTORS_SHIFT + brd->brd_order;
+}
+
+static inline sector_t brd_folio_sectors(struct brd_device *brd)
+{
+	return PAGE_SECTORS << brd->brd_order;
+}
+
 /*
- * Look up and return a brd's page for a given sector.
+ * Look up and return a brd's folio for a given sector.
  */
-static struct page *brd_lookup_page(struct brd_device *brd, sector_t sector)
+static struct folio *brd_lookup_folio(struct brd_device *brd, sector_t sector)
 {
-	return xa_load(&brd->brd_pages, sector >> PAGE_SECTORS_SHIFT);
+	return xa_load(&brd->brd_pages, sector >> brd_folio_shift(brd));
 }
 
 /*
- * Insert a new page for a given sector, if one does not already exist.
+ * Insert a new folio for a given sector, if one does not already exist.
  */
-static struct page *brd_insert_page(struct brd_device *brd, sector_t sector,
+static struct folio *brd_insert_folio(struct brd_device *brd, sector_t sector,
 		blk_opf_t opf)
 	__releases(rcu)
 	__acquires(rcu)
 {
 	gfp_t gfp = (opf & REQ_NOWAIT) ? GFP_NOWAIT : GFP_NOIO;
-	struct page *page, *ret;
+	struct folio *folio, *ret;
 
 	rcu_read_unlock();
-	page = alloc_page(gfp | __GFP_ZERO | __GFP_HIGHMEM);
-	if (!page) {
+	folio = folio_alloc(gfp | __GFP_ZERO | __GFP_HIGHMEM, brd->brd_order);
+	if (!folio) {
 		rcu_read_lock();
 		return ERR_PTR(-ENOMEM);
 	}
 
 	xa_lock(&brd->brd_pages);
-	ret = __xa_cmpxchg(&brd->brd_pages, sector >> PAGE_SECTORS_SHIFT, NULL,
-			page, gfp);
+	ret = __xa_cmpxchg(&brd->brd_pages, sector >> brd_folio_shift(brd),
+			NULL, folio, gfp);
 	rcu_read_lock();
 	if (ret) {
 		xa_unlock(&brd->brd_pages);
-		__free_page(page);
+		folio_put(folio);
 		if (xa_is_err(ret))
 			return ERR_PTR(xa_err(ret));
 		return ret;
 	}
-	brd->brd_nr_pages++;
+	brd->brd_nr_pages += folio_nr_pages(folio);
 	xa_unlock(&brd->brd_pages);
-	return page;
+	return folio;
 }
 
 /*
- * Free all backing store pages and xarray. This must only be called when
+ * Free all backing store folios and xarray. This must only be called when
  * there are no other users of the device.
  */
 static void brd_free_pages(struct brd_device *brd)
 {
-	struct page *page;
+	struct folio *folio;
 	pgoff_t idx;
 
-	xa_for_each(&brd->brd_pages, idx, page) {
-		__free_page(page);
+	xa_for_each(&brd->brd_pages, idx, folio) {
+		folio_put(folio);
 		cond_resched();
 	}
 
@@ -103,77 +122,109 @@ static void brd_free_pages(struct brd_device *brd)
 }
 
 /*
- * Process a single segment.  The segment is capped to not cross page boundaries
- * in both the bio and the brd backing memory.
+ * Return the segment at @iter.  Without highmem a multi-page bvec is
+ * virtually contiguous, so it can be copied with a single memcpy.
  */
-static bool brd_rw_bvec(struct brd_device *brd, struct bio *bio)
+static inline struct bio_vec brd_iter_bvec(struct bio *bio,
+		struct bvec_iter iter)
 {
-	struct bio_vec bv = bio_iter_iovec(bio, bio->bi_iter);
-	sector_t sector = bio->bi_iter.bi_sector;
-	u32 offset = (sector & (PAGE_SECTORS - 1)) << SECTOR_SHIFT;
-	blk_opf_t opf = bio->bi_opf;
-	struct page *page;
+	if (IS_ENABLED(CONFIG_HIGHMEM))
+		return bio_iter_iovec(bio, iter);
+	return mp_bvec_iter_bvec(bio->bi_io_vec, iter);
+}
+
+/*
+ * Process a single segment.  The segment is capped to not cross folio
+ * boundaries in the brd backing memory.
+ */
+static int brd_rw_bvec(struct brd_device *brd, struct bio_vec *bv,
+		sector_t sector, blk_opf_t opf)
+{
+	size_t offset = (sector & (brd_folio_sectors(brd) - 1)) << SECTOR_SHIFT;
+	struct folio *folio;
 	void *kaddr;
 
-	bv.bv_len = min_t(u32, bv.bv_len, PAGE_SIZE - offset);
+	bv->bv_len = min_t(size_t, bv->bv_len,
+			   (PAGE_SIZE << brd->brd_order) - offset);
 
 	rcu_read_lock();
-	page = brd_lookup_page(brd, sector);
-	if (!page && op_is_write(opf)) {
-		page = brd_insert_page(brd, sector, opf);
-		if (IS_ERR(page))
-			goto out_error;
+	folio = brd_lookup_folio(brd, sector);
+	if (!folio && op_is_write(opf)) {
+		folio = brd_insert_folio(brd, sector, opf);
+		if (IS_ERR(folio)) {
+			rcu_read_unlock();
+			return PTR_ERR(folio);
+		}
 	}
 
-	kaddr = bvec_kmap_local(&bv);
+	if (IS_ENABLED(CONFIG_HIGHMEM))
+		kaddr = bvec_kmap_local(bv);
+	else
+		kaddr = bvec_virt(bv);
 	if (op_is_write(opf)) {
-		memcpy_to_page(page, offset, kaddr, bv.bv_len);
+		memcpy_to_folio(folio, offset, kaddr, bv->bv_len);
 	} else {
-		if (page)
-			memcpy_from_page(kaddr, page, offset, bv.bv_len);
+		if (folio)
+			memcpy_from_folio(kaddr, folio, offset, bv->bv_len);
 		else
-			memset(kaddr, 0, bv.bv_len);
+			memset(kaddr, 0, bv->bv_len);
 	}
-	kunmap_local(kaddr);
+	if (IS_ENABLED(CONFIG_HIGHMEM))
+		kunmap_local(kaddr);
 	rcu_read_unlock();
+	return 0;
+}
 
-	bio_advance_iter_single(bio, &bio->bi_iter, bv.bv_len);
-	return true;
+/*
+ * Copy the data described by @iter, which is not advanced in @bio itself so
+ * that blk-mq can still complete the bio later.
+ */
+static int brd_rw_bio(struct brd_device *brd, struct bio *bio,
+		struct bvec_iter iter)
+{
+	int err;
 
-out_error:
-	rcu_read_unlock();
-	if (PTR_ERR(page) == -ENOMEM && (opf & REQ_NOWAIT))
-		bio_wouldblock_error(bio);
-	else
-		bio_io_error(bio);
-	return false;
+	while (iter.bi_size) {
+		struct bio_vec bv = brd_iter_bvec(bio, iter);
+
+		err = brd_rw_bvec(brd, &bv, iter.bi_sector, bio->bi_opf);
+		if (err)
+			return err;
+		bio_advance_iter_single(bio, &iter, bv.bv_len);
+	}
+	return 0;
 }
 
-static void brd_free_one_page(struct rcu_head *head)
+static void brd_free_one_folio(struct rcu_head *head)
 {
 	struct page *page = container_of(head, struct page, rcu_head);
 
-	__free_page(page);
+	folio_put(page_folio(page));
 }
 
+/*
+ * Free the backing folios fully covered by the discarded range.  Partially
+ * covered folios are left alone, as they still hold live data.
+ */
 static void brd_do_discard(struct brd_device *brd, sector_t sector, u32 size)
 {
-	sector_t aligned_sector = round_up(sector, PAGE_SECTORS);
+	sector_t aligned_sector = round_up(sector, brd_folio_sectors(brd));
 	sector_t aligned_end = round_down(
-			sector + (size >> SECTOR_SHIFT), PAGE_SECTORS);
-	struct page *page;
+			sector + (size >> SECTOR_SHIFT), brd_folio_sectors(brd));
+	struct folio *folio;
 
 	if (aligned_end <= aligned_sector)
 		return;
 
 	xa_lock(&brd->brd_pages);
 	while (aligned_sector < aligned_end && aligned_sector < rd_size * 2) {
-		page = __xa_erase(&brd->brd_pages, aligned_sector >> PAGE_SECTORS_SHIFT);
-		if (page) {
-			call_rcu(&page->rcu_head, brd_free_one_page);
-			brd->brd_nr_pages--;
+		folio = __xa_erase(&brd->brd_pages,
+				aligned_sector >> brd_folio_shift(brd));
+		if (folio) {
+			brd->brd_nr_pages -= folio_nr_pages(folio);
+			call_rcu(&folio->page.rcu_head, brd_free_one_folio);
 		}
-		aligned_sector += PAGE_SECTORS;
+		aligned_sector += brd_folio_sectors(brd);
 	}
 	xa_unlock(&brd->brd_pages);
 }
@@ -181,6 +232,7 @@ static void brd_do_discard(struct brd_device *brd, sector_t sector, u32 size)
 static void brd_submit_bio(struct bio *bio)
 {
 	struct brd_device *brd = bio->bi_bdev->bd_disk->private_data;
+	int err;
 
 	if (unlikely(op_is_discard(bio->bi_opf))) {
 		brd_do_discard(brd, bio->bi_iter.bi_sector,
@@ -189,19 +241,62 @@ static void brd_submit_bio(struct bio *bio)
 		return;
 	}
 
-	do {
-		if (!brd_rw_bvec(brd, bio))
-			return;
-	} while (bio->bi_iter.bi_size);
+	err = brd_rw_bio(brd, bio, bio->bi_iter);
+	if (unlikely(err)) {
+		if (err == -ENOMEM && (bio->bi_opf & REQ_NOWAIT))
+			bio_wouldblock_error(bio);
+		else
+			bio_io_error(bio);
+		return;
+	}
 
 	bio_endio(bio);
 }
 
+static blk_status_t brd_queue_rq(struct blk_mq_hw_ctx *hctx,
+		const struct blk_mq_queue_data *bd)
+{
+	struct request *rq = bd->rq;
+	struct brd_device *brd = rq->q->disk->private_data;
+	blk_status_t status = BLK_STS_OK;
+	struct bio *bio;
+	int err;
+
+	blk_mq_start_request(rq);
+
+	if (unlikely(req_op(rq) == REQ_OP_DISCARD)) {
+		brd_do_discard(brd, blk_rq_pos(rq), blk_rq_bytes(rq));
+		goto out;
+	}
+
+	__rq_for_each_bio(bio, rq) {
+		err = brd_rw_bio(brd, bio, bio->bi_iter);
+		if (unlikely(err)) {
+			if (err == -ENOMEM && (rq->cmd_flags & REQ_NOWAIT))
+				status = BLK_STS_AGAIN;
+			else
+				status = BLK_STS_IOERR;
+			break;
+		}
+	}
+out:
+	blk_mq_end_request(rq, status);
+	return BLK_STS_OK;
+}
+
+static const struct blk_mq_ops brd_mq_ops = {
+	.queue_rq	= brd_queue_rq,
+};
+
 static const struct block_device_operations brd_fops = {
 	.owner =		THIS_MODULE,
 	.submit_bio =		brd_submit_bio,
 };
 
+static const struct block_device_operations brd_mq_fops = {
+	.owner =		THIS_MODULE,
+};
+
 /*
  * And now the modules code and kernel interface.
  */
@@ -217,6 +312,14 @@ static int max_part = 1;
 module_param(max_part, int, 0444);
 MODULE_PARM_DESC(max_part, "Num Minors to reserve between devices");
 
+static unsigned int rd_folio_order;
+module_param(rd_folio_order, uint, 0444);
+MODULE_PARM_DESC(rd_folio_order, "Order of the folios backing each RAM disk. Default: 0 (single pages)");
+
+static unsigned int rd_hw_queues;
+module_param(rd_hw_queues, uint, 0444);
+MODULE_PARM_DESC(rd_hw_queues, "Number of blk-mq hardware queues per RAM disk. Default: 0 (bio based)");
+
 MODULE_DESCRIPTION("Ram backed block device driver");
 MODULE_LICENSE("GPL");
 MODULE_ALIAS_BLOCKDEV_MAJOR(RAMDISK_MAJOR);
@@ -288,7 +391,7 @@ static int brd_alloc(int i)
 		.physical_block_size	= PAGE_SIZE,
 		.max_hw_discard_sectors	= UINT_MAX,
 		.max_discard_segments	= 1,
-		.discard_granularity	= PAGE_SIZE,
+		.discard_granularity	= PAGE_SIZE << rd_folio_order,
 		.features		= BLK_FEAT_SYNCHRONOUS |
 					  BLK_FEAT_NOWAIT,
 	};
@@ -298,21 +401,42 @@ static int brd_alloc(int i)
 		return PTR_ERR(brd);
 
 	xa_init(&brd->brd_pages);
+	brd->brd_order = rd_folio_order;
 
 	snprintf(buf, DISK_NAME_LEN, "ram%d", i);
 	if (!IS_ERR_OR_NULL(brd_debugfs_dir))
 		debugfs_create_u64(buf, 0444, brd_debugfs_dir,
 				&brd->brd_nr_pages);
 
-	disk = brd->brd_disk = blk_alloc_disk(&lim, NUMA_NO_NODE);
+	if (rd_hw_queues) {
+		struct blk_mq_tag_set *set = &brd->brd_tag_set;
+
+		/*
+		 * Backing folios are allocated with GFP_NOIO from ->queue_rq,
+		 * so the hardware queues must be allowed to block.
+		 */
+		set->ops = &brd_mq_ops;
+		set->nr_hw_queues = min(rd_hw_queues, nr_cpu_ids);
+		set->queue_depth = BRD_HW_QUEUE_DEPTH;
+		set->numa_node = NUMA_NO_NODE;
+		set->flags = BLK_MQ_F_BLOCKING;
+		err = blk_mq_alloc_tag_set(set);
+		if (err)
+			goto out_free_dev;
+
+		disk = blk_mq_alloc_disk(set, &lim, brd);
+	} else {
+		disk = blk_alloc_disk(&lim, NUMA_NO_NODE);
+	}
+	brd->brd_disk = disk;
 	if (IS_ERR(disk)) {
 		err = PTR_ERR(disk);
-		goto out_free_dev;
+		goto out_free_tag_set;
 	}
 	disk->major		= RAMDISK_MAJOR;
 	disk->first_minor	= i * max_part;
 	disk->minors		= max_part;
-	disk->fops		= &brd_fops;
+	disk->fops		= rd_hw_queues ? &brd_mq_fops : &brd_fops;
 	disk->private_data	= brd;
 	strscpy(disk->disk_name, buf, DISK_NAME_LEN);
 	set_capacity(disk, rd_size * 2);
@@ -325,6 +449,9 @@ static int brd_alloc(int i)
 
 out_cleanup_disk:
 	put_disk(disk);
+out_free_tag_set:
+	if (rd_hw_queues)
+		blk_mq_free_tag_set(&brd->brd_tag_set);
 out_free_dev:
 	brd_free_device(brd);
 	return err;
@@ -344,6 +471,8 @@ static void brd_cleanup(void)
 	list_for_each_entry_safe(brd, next, &brd_devices, brd_list) {
 		del_gendisk(brd->brd_disk);
 		put_disk(brd->brd_disk);
+		if (rd_hw_queues)
+			blk_mq_free_tag_set(&brd->brd_tag_set);
 		brd_free_pages(brd);
 		brd_free_device(brd);
 	}
@@ -366,6 +495,12 @@ static inline void brd_check_and_reset_par(void)
 			DISK_MAX_PARTS, DISK_MAX_PARTS);
 		max_part = DISK_MAX_PARTS;
 	}
+
+	if (rd_folio_order > MAX_PAGE_ORDER) {
+		pr_info("brd: rd_folio_order can't be larger than %d, reset rd_folio_order = %d.\n",
+			MAX_PAGE_ORDER, MAX_PAGE_ORDER);
+		rd_folio_order = MAX_PAGE_ORDER;
+	}
 }
 
 static int __init brd_init(void)
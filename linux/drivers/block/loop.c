@@ -45,6 +45,12 @@ enum {
 	Lo_deleting,
 };
 
+struct loop_stats {
+	u64		nowait_issued;	/* aio issued inline from ->queue_rq */
+	u64		nowait_again;	/* inline aio that returned -EAGAIN */
+	u64		work_queued;	/* commands handed to a worker */
+};
+
 struct loop_device {
 	int		lo_number;
 	loff_t		lo_offset;
@@ -68,6 +74,7 @@ struct loop_device {
 	struct rb_root          worker_tree;
 	struct timer_list       timer;
 	bool			sysfs_inited;
+	struct loop_stats __percpu *stats;
 
 	struct request_queue	*lo_queue;
 	struct blk_mq_tag_set	tag_set;
@@ -79,6 +86,7 @@ struct loop_device {
 struct loop_cmd {
 	struct list_head list_entry;
 	bool use_aio; /* use AIO interface to handle I/O */
+	bool nowait_again; /* IOCB_NOWAIT failed, retry from a worker */
 	atomic_t ref; /* only for aio */
 	long ret;
 	struct kiocb iocb;
@@ -89,6 +97,7 @@ struct loop_cmd {
 
 #define LOOP_IDLE_WORKER_TIMEOUT (60 * HZ)
 #define LOOP_DEFAULT_HW_Q_DEPTH 128
+#define LOOP_DEFAULT_NR_HW_QUEUES 1
 
 static DEFINE_IDR(loop_index_idr);
 static DEFINE_MUTEX(loop_ctl_mutex);
@@ -284,8 +293,22 @@ static int lo_req_flush(struct loop_device *lo, struct request *rq)
 static void lo_complete_rq(struct request *rq)
 {
 	struct loop_cmd *cmd = blk_mq_rq_to_pdu(rq);
+	struct loop_device *lo = rq->q->queuedata;
 	blk_status_t ret = BLK_STS_OK;
 
+	/*
+	 * The lower layers may only find out that they would have to block
+	 * after a non-blocking submission was queued.  Nothing was done in
+	 * that case, so requeue the command and let a worker issue it.
+	 */
+	if (cmd->ret == -EAGAIN && (cmd->iocb.ki_flags & IOCB_NOWAIT)) {
+		this_cpu_inc(lo->stats->nowait_again);
+		cmd->ret = 0;
+		cmd->nowait_again = true;
+		blk_mq_requeue_request(rq, true);
+		return;
+	}
+
 	if (cmd->ret < 0 || cmd->ret == blk_rq_bytes(rq) ||
 	    req_op(rq) != REQ_OP_READ) {
 		if (cmd->ret < 0)
@@ -338,7 +361,7 @@ static void lo_rw_aio_complete(struct kiocb *iocb, long ret)
 }
 
 static int lo_rw_aio(struct loop_device *lo, struct loop_cmd *cmd,
-		     loff_t pos, int rw)
+		     loff_t pos, int rw, bool nowait)
 {
 	struct iov_iter iter;
 	struct req_iterator rq_iter;
@@ -359,7 +382,7 @@ static int lo_rw_aio(struct loop_device *lo, struct loop_cmd *cmd,
 		bvec = kmalloc_array(nr_bvec, sizeof(struct bio_vec),
 				     GFP_NOIO);
 		if (!bvec)
-			return -EIO;
+			return nowait ? -EAGAIN : -EIO;
 		cmd->bvec = bvec;
 
 		/*
@@ -394,6 +417,8 @@ static int lo_rw_aio(struct loop_device *lo, struct loop_cmd *cmd,
 	if (cmd->use_aio) {
 		cmd->iocb.ki_complete = lo_rw_aio_complete;
 		cmd->iocb.ki_flags = IOCB_DIRECT;
+		if (nowait)
+			cmd->iocb.ki_flags |= IOCB_NOWAIT;
 	} else {
 		cmd->iocb.ki_complete = NULL;
 		cmd->iocb.ki_flags = 0;
@@ -405,6 +430,18 @@ static int lo_rw_aio(struct loop_device *lo, struct loop_cmd *cmd,
 	} else
 		ret = file->f_op->read_iter(&cmd->iocb, &iter);
 
+	/*
+	 * Nothing has been issued if the non-blocking attempt failed with
+	 * -EAGAIN, so undo the setup and leave the command to the caller.
+	 */
+	if (nowait && ret == -EAGAIN) {
+		if (rw == ITER_SOURCE)
+			kiocb_end_write(&cmd->iocb);
+		kfree(cmd->bvec);
+		cmd->bvec = NULL;
+		return -EAGAIN;
+	}
+
 	lo_rw_aio_do_completion(cmd);
 
 	if (ret != -EIOCBQUEUED)
@@ -432,15 +469,77 @@ static int do_req_filebacked(struct loop_device *lo, struct request *rq)
 	case REQ_OP_DISCARD:
 		return lo_fallocate(lo, rq, pos, FALLOC_FL_PUNCH_HOLE);
 	case REQ_OP_WRITE:
-		return lo_rw_aio(lo, cmd, pos, ITER_SOURCE);
+		return lo_rw_aio(lo, cmd, pos, ITER_SOURCE, false);
 	case REQ_OP_READ:
-		return lo_rw_aio(lo, cmd, pos, ITER_DEST);
+		return lo_rw_aio(lo, cmd, pos, ITER_DEST, false);
 	default:
 		WARN_ON_ONCE(1);
 		return -EIO;
 	}
 }
 
+/*
+ * The workers charge I/O to the cgroups of the first bio.  Issuing inline
+ * charges it to the current task instead, which is only right if that is
+ * the same cgroup, so ->queue_rq called from kblockd or a requeue has to
+ * leave the command to a worker.
+ */
+static bool lo_cmd_css_is_current(struct loop_cmd *cmd)
+{
+#ifdef CONFIG_BLK_CGROUP
+	bool same;
+
+	if (!cmd->blkcg_css)
+		return true;
+
+	rcu_read_lock();
+	same = cmd->blkcg_css == task_css(current, io_cgrp_id);
+	rcu_read_unlock();
+	return same;
+#else
+	return true;
+#endif
+}
+
+/*
+ * Direct I/O to a backing file that supports IOCB_NOWAIT can be issued
+ * straight from ->queue_rq, which saves the context switch to a worker for
+ * every command that doesn't have to block.  This is only done on devices
+ * created with the inline_nowait module parameter, as ->queue_rq must be
+ * allowed to sleep for it.
+ */
+static bool lo_can_try_nowait(struct loop_device *lo, struct loop_cmd *cmd)
+{
+	struct request *rq = blk_mq_rq_from_pdu(cmd);
+	bool nowait_again = cmd->nowait_again;
+
+	cmd->nowait_again = false;
+	if (!(lo->tag_set.flags & BLK_MQ_F_BLOCKING))
+		return false;
+	if (!cmd->use_aio || nowait_again)
+		return false;
+	if (!(lo->lo_backing_file->f_mode & FMODE_NOWAIT))
+		return false;
+	if (op_is_write(req_op(rq)) && (lo->lo_flags & LO_FLAGS_READ_ONLY))
+		return false;
+	return lo_cmd_css_is_current(cmd);
+}
+
+static int lo_rw_aio_nowait(struct loop_device *lo, struct loop_cmd *cmd)
+{
+	struct request *rq = blk_mq_rq_from_pdu(cmd);
+	loff_t pos = ((loff_t) blk_rq_pos(rq) << 9) + lo->lo_offset;
+	int rw = req_op(rq) == REQ_OP_WRITE ? ITER_SOURCE : ITER_DEST;
+	unsigned int noio_flags;
+	int ret;
+
+	/* Don't recurse into the loop device from memory reclaim. */
+	noio_flags = memalloc_noio_save();
+	ret = lo_rw_aio(lo, cmd, pos, rw, true);
+	memalloc_noio_restore(noio_flags);
+	return ret;
+}
+
 static void loop_reread_partitions(struct loop_device *lo)
 {
 	int rc;
@@ -704,12 +803,30 @@ static ssize_t loop_attr_dio_show(struct loop_device *lo, char *buf)
 	return sysfs_emit(buf, "%s\n", dio ? "1" : "0");
 }
 
+#define LOOP_STAT_SHOW(_name)						\
+static ssize_t loop_attr_##_name##_show(struct loop_device *lo, char *buf)	\
+{									\
+	u64 sum = 0;							\
+	int cpu;							\
+									\
+	for_each_possible_cpu(cpu)					\
+		sum += per_cpu_ptr(lo->stats, cpu)->_name;		\
+	return sysfs_emit(buf, "%llu\n", sum);				\
+}
+
+LOOP_STAT_SHOW(nowait_issued);
+LOOP_STAT_SHOW(nowait_again);
+LOOP_STAT_SHOW(work_queued);
+
 LOOP_ATTR_RO(backing_file);
 LOOP_ATTR_RO(offset);
 LOOP_ATTR_RO(sizelimit);
 LOOP_ATTR_RO(autoclear);
 LOOP_ATTR_RO(partscan);
 LOOP_ATTR_RO(dio);
+LOOP_ATTR_RO(nowait_issued);
+LOOP_ATTR_RO(nowait_again);
+LOOP_ATTR_RO(work_queued);
 
 static struct attribute *loop_attrs[] = {
 	&loop_attr_backing_file.attr,
@@ -718,6 +835,9 @@ static struct attribute *loop_attrs[] = {
 	&loop_attr_autoclear.attr,
 	&loop_attr_partscan.attr,
 	&loop_attr_dio.attr,
+	&loop_attr_nowait_issued.attr,
+	&loop_attr_nowait_again.attr,
+	&loop_attr_work_queued.attr,
 	NULL,
 };
 
@@ -1758,6 +1878,7 @@ static void lo_free_disk(struct gendisk *disk)
 	loop_free_idle_workers(lo, true);
 	timer_shutdown_sync(&lo->timer);
 	mutex_destroy(&lo->lo_mutex);
+	free_percpu(lo->stats);
 	kfree(lo);
 }
 
@@ -1842,6 +1963,33 @@ static const struct kernel_param_ops loop_hw_qdepth_param_ops = {
 device_param_cb(hw_queue_depth, &loop_hw_qdepth_param_ops, &hw_queue_depth, 0444);
 MODULE_PARM_DESC(hw_queue_depth, "Queue depth for each hardware queue. Default: " __stringify(LOOP_DEFAULT_HW_Q_DEPTH));
 
+static int nr_hw_queues = LOOP_DEFAULT_NR_HW_QUEUES;
+
+static int loop_set_nr_hw_queues(const char *s, const struct kernel_param *p)
+{
+	int nr, ret;
+
+	ret = kstrtoint(s, 0, &nr);
+	if (ret < 0)
+		return ret;
+	if (nr < 1)
+		return -EINVAL;
+	nr_hw_queues = nr;
+	return 0;
+}
+
+static const struct kernel_param_ops loop_nr_hw_queues_param_ops = {
+	.set	= loop_set_nr_hw_queues,
+	.get	= param_get_int,
+};
+
+device_param_cb(nr_hw_queues, &loop_nr_hw_queues_param_ops, &nr_hw_queues, 0444);
+MODULE_PARM_DESC(nr_hw_queues, "Number of hardware queues, capped at the number of CPUs. Default: " __stringify(LOOP_DEFAULT_NR_HW_QUEUES));
+
+static bool inline_nowait;
+module_param(inline_nowait, bool, 0444);
+MODULE_PARM_DESC(inline_nowait, "Issue direct I/O with IOCB_NOWAIT from ->queue_rq before falling back to workers. Default: false");
+
 MODULE_DESCRIPTION("Loopback device support");
 MODULE_LICENSE("GPL");
 MODULE_ALIAS_BLOCKDEV_MAJOR(LOOP_MAJOR);
@@ -1873,17 +2021,26 @@ static blk_status_t loop_queue_rq(struct blk_mq_hw_ctx *hctx,
 	cmd->blkcg_css = NULL;
 	cmd->memcg_css = NULL;
 #ifdef CONFIG_BLK_CGROUP
-	if (rq->bio) {
+	if (rq->bio)
 		cmd->blkcg_css = bio_blkcg_css(rq->bio);
-#ifdef CONFIG_MEMCG
-		if (cmd->blkcg_css) {
-			cmd->memcg_css =
-				cgroup_get_e_css(cmd->blkcg_css->cgroup,
-						&memory_cgrp_subsys);
-		}
 #endif
+
+	if (lo_can_try_nowait(lo, cmd)) {
+		if (lo_rw_aio_nowait(lo, cmd) != -EAGAIN) {
+			this_cpu_inc(lo->stats->nowait_issued);
+			return BLK_STS_OK;
+		}
+		this_cpu_inc(lo->stats->nowait_again);
+	}
+
+#if defined(CONFIG_BLK_CGROUP) && defined(CONFIG_MEMCG)
+	if (cmd->blkcg_css) {
+		cmd->memcg_css =
+			cgroup_get_e_css(cmd->blkcg_css->cgroup,
+					&memory_cgrp_subsys);
 	}
 #endif
+	this_cpu_inc(lo->stats->work_queued);
 	loop_queue_work(lo, cmd);
 
 	return BLK_STS_OK;
@@ -2006,6 +2163,9 @@ static int loop_add(int i)
 	lo = kzalloc(sizeof(*lo), GFP_KERNEL);
 	if (!lo)
 		goto out;
+	lo->stats = alloc_percpu(struct loop_stats);
+	if (!lo->stats)
+		goto out_free_dev;
 	lo->worker_tree = RB_ROOT;
 	INIT_LIST_HEAD(&lo->idle_worker_list);
 	timer_setup(&lo->timer, loop_free_idle_workers_timer, TIMER_DEFERRABLE);
@@ -2029,11 +2189,19 @@ static int loop_add(int i)
 	i = err;
 
 	lo->tag_set.ops = &loop_mq_ops;
-	lo->tag_set.nr_hw_queues = 1;
+	lo->tag_set.nr_hw_queues = min_t(unsigned int, nr_hw_queues,
+					 nr_cpu_ids);
 	lo->tag_set.queue_depth = hw_queue_depth;
 	lo->tag_set.numa_node = NUMA_NO_NODE;
 	lo->tag_set.cmd_size = sizeof(struct loop_cmd);
 	lo->tag_set.flags = BLK_MQ_F_STACKING | BLK_MQ_F_NO_SCHED_BY_DEFAULT;
+	/*
+	 * Inline direct I/O from ->queue_rq can sleep even with IOCB_NOWAIT
+	 * set (e.g. for memory allocations), so only devices that opt in pay
+	 * for the blocking dispatch path.
+	 */
+	if (inline_nowait)
+		lo->tag_set.flags |= BLK_MQ_F_BLOCKING;
 	lo->tag_set.driver_data = lo;
 
 	err = blk_mq_alloc_tag_set(&lo->tag_set);
@@ -2103,6 +2271,7 @@ out_free_idr:
 	idr_remove(&loop_index_idr, i);
 	mutex_unlock(&loop_ctl_mutex);
 out_free_dev:
+	free_percpu(lo->stats);
 	kfree(lo);
 out:
 	return err;
@@ -44,6 +44,7 @@
 #include <linux/task_work.h>
 #include <linux/namei.h>
 #include <linux/kref.h>
+#include <linux/kfifo.h>
 #include <uapi/linux/ublk_cmd.h>
 
 #define UBLK_MINORS		(1U << MINORBITS)
@@ -58,6 +59,11 @@
 #define UBLK_IO_REGISTER_IO_BUF		_IOC_NR(UBLK_U_IO_REGISTER_IO_BUF)
 #define UBLK_IO_UNREGISTER_IO_BUF	_IOC_NR(UBLK_U_IO_UNREGISTER_IO_BUF)
 
+/* pdu->tag of the per-queue UBLK_U_IO_FETCH_IO_CMDS command */
+#define UBLK_BATCH_FETCH_TAG	((u16)-1)
+/* commit elements copied from userspace at a time */
+#define UBLK_BATCH_COMMIT_CHUNK	16
+
 /* All UBLK_F_* have to be included into UBLK_F_ALL */
 #define UBLK_F_ALL (UBLK_F_SUPPORT_ZERO_COPY \
 		| UBLK_F_URING_CMD_COMP_IN_TASK \
@@ -73,7 +79,8 @@
 		| UBLK_F_AUTO_BUF_REG \
 		| UBLK_F_QUIESCE \
 		| UBLK_F_PER_IO_DAEMON \
-		| UBLK_F_BUF_REG_OFF_DAEMON)
+		| UBLK_F_BUF_REG_OFF_DAEMON \
+		| UBLK_F_BATCH_IO)
 
 #define UBLK_F_ALL_RECOVERY_FLAGS (UBLK_F_USER_RECOVERY \
 		| UBLK_F_USER_RECOVERY_REISSUE \
@@ -106,6 +113,10 @@ struct ublk_uring_cmd_pdu {
 	struct ublk_queue *ubq;
 
 	u16 tag;
+
+	/* valid for UBLK_U_IO_FETCH_IO_CMDS only */
+	u16 batch_nr;
+	unsigned short __user *batch_buf;
 };
 
 /*
@@ -204,6 +215,16 @@ struct ublk_queue {
 	unsigned short nr_io_ready;	/* how many ios setup */
 	spinlock_t		cancel_lock;
 	struct ublk_device *dev;
+
+	/*
+	 * UBLK_F_BATCH_IO: tags of requests waiting for delivery, and the
+	 * pending UBLK_U_IO_FETCH_IO_CMDS command, both under batch_lock
+	 */
+	spinlock_t		batch_lock;
+	struct io_uring_cmd	*fetch_cmd;
+	DECLARE_KFIFO_PTR(evts_fifo, unsigned short);
+	unsigned short		*batch_tags;
+
 	struct ublk_io ios[];
 };
 
@@ -674,6 +695,11 @@ static inline bool ublk_support_user_copy(const struct ublk_queue *ubq)
 	return ubq->flags & UBLK_F_USER_COPY;
 }
 
+static inline bool ublk_support_batch_io(const struct ublk_queue *ubq)
+{
+	return ubq->flags & UBLK_F_BATCH_IO;
+}
+
 static inline bool ublk_need_map_io(const struct ublk_queue *ubq)
 {
 	return !ublk_support_user_copy(ubq) && !ublk_support_zero_copy(ubq) &&
@@ -1329,11 +1355,143 @@ static void ublk_cmd_tw_cb(struct io_uring_cmd *cmd,
 	ublk_dispatch_req(ubq, pdu->req, issue_flags);
 }
 
-static void ublk_queue_cmd(struct ublk_queue *ubq, struct request *rq)
+/*
+ * Prepare one request for delivery through the queue's fetch command,
+ * which also owns the automatically registered buffer.  The io is left
+ * idle if the request can't be delivered.  Ownership only moves to the
+ * server in ublk_batch_commit_req(), once its tag has reached userspace.
+ */
+static bool ublk_batch_prep_req(struct ublk_queue *ubq,
+				struct request *req,
+				struct io_uring_cmd *cmd,
+				unsigned int issue_flags)
+{
+	struct ublk_io *io = &ubq->ios[req->tag];
+
+	if (unlikely(current != io->task || current->flags & PF_EXITING)) {
+		__ublk_abort_rq(ubq, req);
+		return false;
+	}
+
+	if (!ublk_start_io(ubq, req, io))
+		return false;
+
+	io->cmd = cmd;
+	if (!ublk_prep_auto_buf_reg(ubq, req, io, issue_flags)) {
+		io->cmd = NULL;
+		return false;
+	}
+	return true;
+}
+
+static void ublk_batch_commit_req(struct ublk_queue *ubq, struct request *req)
+{
+	struct ublk_io *io = &ubq->ios[req->tag];
+
+	__ublk_prep_compl_io_cmd(io, req);
+	/* the fetch command is about to complete, don't keep pointing at it */
+	io->cmd = NULL;
+}
+
+/* undo ublk_batch_prep_req() for a request the server never saw */
+static void ublk_batch_unprep_req(struct ublk_queue *ubq, struct request *req,
+				  unsigned int issue_flags)
+{
+	struct ublk_io *io = &ubq->ios[req->tag];
+
+	if (io->flags & UBLK_IO_FLAG_AUTO_BUF_REG) {
+		io->flags &= ~UBLK_IO_FLAG_AUTO_BUF_REG;
+		io_buffer_unregister_bvec(io->cmd, io->buf.index, issue_flags);
+	}
+	io->cmd = NULL;
+}
+
+/*
+ * Move pending requests to the ublk server, and return how many tags
+ * have been stored in the fetch command's buffer.
+ *
+ * Only the queue's daemon task may issue the fetch command, so this is
+ * serialized for each queue and ->batch_tags can be used without locking.
+ */
+static int ublk_batch_deliver(struct ublk_queue *ubq, struct io_uring_cmd *cmd,
+			      unsigned int issue_flags)
 {
-	struct io_uring_cmd *cmd = ubq->ios[rq->tag].cmd;
 	struct ublk_uring_cmd_pdu *pdu = ublk_get_uring_cmd_pdu(cmd);
+	struct blk_mq_tags *tags = ubq->dev->tag_set.tags[ubq->q_id];
+	unsigned short *batch = ubq->batch_tags;
+	unsigned int i, nr, done = 0;
+
+	spin_lock(&ubq->batch_lock);
+	nr = kfifo_out(&ubq->evts_fifo, batch,
+		       min_t(unsigned int, pdu->batch_nr, ubq->q_depth));
+	spin_unlock(&ubq->batch_lock);
+
+	for (i = 0; i < nr; i++) {
+		struct request *req = blk_mq_tag_to_rq(tags, batch[i]);
+
+		if (ublk_batch_prep_req(ubq, req, cmd, issue_flags))
+			batch[done++] = batch[i];
+	}
+
+	if (!done)
+		return 0;
+
+	/*
+	 * If the server can't be told about the requests, give them back to
+	 * the fifo so that the next fetch delivers them.
+	 */
+	if (copy_to_user(pdu->batch_buf, batch, done * sizeof(*batch))) {
+		for (i = 0; i < done; i++)
+			ublk_batch_unprep_req(ubq,
+					blk_mq_tag_to_rq(tags, batch[i]),
+					issue_flags);
+		spin_lock(&ubq->batch_lock);
+		kfifo_in(&ubq->evts_fifo, batch, done);
+		spin_unlock(&ubq->batch_lock);
+		return -EFAULT;
+	}
+
+	for (i = 0; i < done; i++)
+		ublk_batch_commit_req(ubq, blk_mq_tag_to_rq(tags, batch[i]));
+	return done;
+}
+
+static void ublk_batch_fetch_tw_cb(struct io_uring_cmd *cmd,
+				   unsigned int issue_flags)
+{
+	struct ublk_uring_cmd_pdu *pdu = ublk_get_uring_cmd_pdu(cmd);
+
+	io_uring_cmd_done(cmd, ublk_batch_deliver(pdu->ubq, cmd, issue_flags),
+			  0, issue_flags);
+}
 
+static void ublk_batch_queue_req(struct ublk_queue *ubq, struct request *rq)
+{
+	struct io_uring_cmd *cmd;
+
+	spin_lock(&ubq->batch_lock);
+	kfifo_put(&ubq->evts_fifo, rq->tag);
+	cmd = ubq->fetch_cmd;
+	ubq->fetch_cmd = NULL;
+	spin_unlock(&ubq->batch_lock);
+
+	/* requests queued meanwhile are picked up by the same fetch */
+	if (cmd)
+		io_uring_cmd_complete_in_task(cmd, ublk_batch_fetch_tw_cb);
+}
+
+static void ublk_queue_cmd(struct ublk_queue *ubq, struct request *rq)
+{
+	struct io_uring_cmd *cmd;
+	struct ublk_uring_cmd_pdu *pdu;
+
+	if (ublk_support_batch_io(ubq)) {
+		ublk_batch_queue_req(ubq, rq);
+		return;
+	}
+
+	cmd = ubq->ios[rq->tag].cmd;
+	pdu = ublk_get_uring_cmd_pdu(cmd);
 	pdu->req = rq;
 	io_uring_cmd_complete_in_task(cmd, ublk_cmd_tw_cb);
 }
@@ -1467,6 +1625,11 @@ static void ublk_queue_rqs(struct rq_list *rqlist)
 			continue;
 		}
 
+		if (ublk_support_batch_io(this_q)) {
+			ublk_batch_queue_req(this_q, req);
+			continue;
+		}
+
 		if (io && !ublk_belong_to_same_batch(io, this_io) &&
 				!rq_list_empty(&submit_list))
 			ublk_queue_cmd_list(io, &submit_list);
@@ -1502,6 +1665,8 @@ static void ublk_queue_reinit(struct ublk_device *ub, struct ublk_queue *ubq)
 
 	/* All old ioucmds have to be completed */
 	ubq->nr_io_ready = 0;
+	ubq->fetch_cmd = NULL;
+	kfifo_reset(&ubq->evts_fifo);
 
 	for (i = 0; i < ubq->q_depth; i++) {
 		struct ublk_io *io = &ubq->ios[i];
@@ -1807,6 +1972,22 @@ static void ublk_abort_queue(struct ublk_device *ub, struct ublk_queue *ubq)
 {
 	int i;
 
+	/* requests which haven't been delivered to the server yet */
+	if (ublk_support_batch_io(ubq)) {
+		struct blk_mq_tags *tags = ub->tag_set.tags[ubq->q_id];
+		unsigned short tag;
+		bool pending;
+
+		for (;;) {
+			spin_lock(&ubq->batch_lock);
+			pending = kfifo_get(&ubq->evts_fifo, &tag);
+			spin_unlock(&ubq->batch_lock);
+			if (!pending)
+				break;
+			__ublk_abort_rq(ubq, blk_mq_tag_to_rq(tags, tag));
+		}
+	}
+
 	for (i = 0; i < ubq->q_depth; i++) {
 		struct ublk_io *io = &ubq->ios[i];
 
@@ -1876,6 +2057,24 @@ static void ublk_cancel_cmd(struct ublk_queue *ubq, unsigned tag,
 		io_uring_cmd_done(io->cmd, UBLK_IO_RES_ABORT, 0, issue_flags);
 }
 
+/*
+ * A fetch command claimed by ublk_batch_queue_req() isn't canceled, it is
+ * completed from ublk_batch_fetch_tw_cb() instead.
+ */
+static void ublk_batch_cancel_fetch(struct ublk_queue *ubq,
+				    unsigned int issue_flags)
+{
+	struct io_uring_cmd *cmd;
+
+	spin_lock(&ubq->batch_lock);
+	cmd = ubq->fetch_cmd;
+	ubq->fetch_cmd = NULL;
+	spin_unlock(&ubq->batch_lock);
+
+	if (cmd)
+		io_uring_cmd_done(cmd, UBLK_IO_RES_ABORT, 0, issue_flags);
+}
+
 /*
  * The ublk char device won't be closed when calling cancel fn, so both
  * ublk device and queue are guaranteed to be live
@@ -1902,6 +2101,12 @@ static void ublk_uring_cmd_cancel_fn(struct io_uring_cmd *cmd,
 	if (WARN_ON_ONCE(!ubq))
 		return;
 
+	if (pdu->tag == UBLK_BATCH_FETCH_TAG) {
+		ublk_start_cancel(ubq->dev);
+		ublk_batch_cancel_fetch(ubq, issue_flags);
+		return;
+	}
+
 	if (WARN_ON_ONCE(pdu->tag >= ubq->q_depth))
 		return;
 
@@ -1925,6 +2130,11 @@ static void ublk_cancel_queue(struct ublk_queue *ubq)
 {
 	int i;
 
+	if (ublk_support_batch_io(ubq)) {
+		ublk_batch_cancel_fetch(ubq, IO_URING_F_UNLOCKED);
+		return;
+	}
+
 	for (i = 0; i < ubq->q_depth; i++)
 		ublk_cancel_cmd(ubq, i, IO_URING_F_UNLOCKED);
 }
@@ -2372,6 +2582,11 @@ static int __ublk_ch_uring_cmd(struct io_uring_cmd *cmd,
 	if (tag >= ubq->q_depth)
 		goto out;
 
+	/* IOs are fetched and committed in batches */
+	if (ublk_support_batch_io(ubq) &&
+	    _IOC_NR(cmd_op) != UBLK_IO_REGISTER_IO_BUF)
+		goto out;
+
 	io = &ubq->ios[tag];
 	/* UBLK_IO_FETCH_REQ can be handled on any task, which sets io->task */
 	if (unlikely(_IOC_NR(cmd_op) == UBLK_IO_FETCH_REQ)) {
@@ -2494,6 +2709,161 @@ fail_put:
 	return NULL;
 }
 
+/* the first fetch command sets up all IOs of the queue at once */
+static void ublk_batch_setup_queue(struct ublk_queue *ubq)
+{
+	struct ublk_device *ub = ubq->dev;
+	int i;
+
+	mutex_lock(&ub->mutex);
+	for (i = 0; i < ubq->q_depth && !ublk_queue_ready(ubq); i++) {
+		struct ublk_io *io = &ubq->ios[i];
+
+		WARN_ON_ONCE(io->flags & (UBLK_IO_FLAG_ACTIVE |
+					  UBLK_IO_FLAG_OWNED_BY_SRV));
+		io->cmd = NULL;
+		io->flags |= UBLK_IO_FLAG_ACTIVE;
+		io->buf = (struct ublk_auto_buf_reg) { .index = i };
+		WRITE_ONCE(io->task, get_task_struct(current));
+		ublk_mark_io_ready(ub, ubq);
+	}
+	mutex_unlock(&ub->mutex);
+}
+
+static int ublk_batch_fetch(struct io_uring_cmd *cmd, struct ublk_queue *ubq,
+			    const struct ublk_batch_io *uc,
+			    unsigned int issue_flags)
+{
+	struct ublk_uring_cmd_pdu *pdu = ublk_get_uring_cmd_pdu(cmd);
+
+	if (!uc->nr_elem || uc->flags)
+		return -EINVAL;
+
+	if (unlikely(!ublk_queue_ready(ubq)))
+		ublk_batch_setup_queue(ubq);
+
+	if (READ_ONCE(ubq->ios[0].task) != current)
+		return -EINVAL;
+
+	pdu->ubq = ubq;
+	pdu->tag = UBLK_BATCH_FETCH_TAG;
+	pdu->batch_nr = uc->nr_elem;
+	pdu->batch_buf = u64_to_user_ptr(uc->addr);
+
+	spin_lock(&ubq->batch_lock);
+	if (ubq->fetch_cmd) {
+		spin_unlock(&ubq->batch_lock);
+		return -EBUSY;
+	}
+	if (kfifo_is_empty(&ubq->evts_fifo)) {
+		ubq->fetch_cmd = cmd;
+		spin_unlock(&ubq->batch_lock);
+		io_uring_cmd_mark_cancelable(cmd, issue_flags);
+		return -EIOCBQUEUED;
+	}
+	spin_unlock(&ubq->batch_lock);
+
+	return ublk_batch_deliver(ubq, cmd, issue_flags);
+}
+
+static int ublk_batch_commit_one(struct io_uring_cmd *cmd,
+				 struct ublk_queue *ubq,
+				 const struct ublk_batch_commit_elem *elem,
+				 u16 flags, unsigned int issue_flags)
+{
+	u16 buf_idx = UBLK_INVALID_BUF_IDX;
+	struct ublk_io *io;
+	struct request *req;
+	bool compl;
+
+	if (elem->tag >= ubq->q_depth)
+		return -EINVAL;
+
+	io = &ubq->ios[elem->tag];
+	if (READ_ONCE(io->task) != current)
+		return -EINVAL;
+	if (!(io->flags & UBLK_IO_FLAG_OWNED_BY_SRV))
+		return -EBUSY;
+
+	io->res = elem->result;
+	req = ublk_fill_io_cmd(io, NULL);
+	if (ublk_support_auto_buf_reg(ubq)) {
+		if (io->flags & UBLK_IO_FLAG_AUTO_BUF_REG) {
+			io->flags &= ~UBLK_IO_FLAG_AUTO_BUF_REG;
+			if (io->buf_ctx_handle == io_uring_cmd_ctx_handle(cmd))
+				buf_idx = io->buf.index;
+		}
+		io->buf.index = elem->buf_index;
+		io->buf.flags = 0;
+		if (flags & UBLK_BATCH_F_AUTO_BUF_REG_FALLBACK)
+			io->buf.flags |= UBLK_AUTO_BUF_REG_FALLBACK;
+	}
+	compl = ublk_need_complete_req(ubq, io);
+
+	/* can't touch 'ublk_io' any more */
+	if (buf_idx != UBLK_INVALID_BUF_IDX)
+		io_buffer_unregister_bvec(cmd, buf_idx, issue_flags);
+	if (req_op(req) == REQ_OP_ZONE_APPEND)
+		req->__sector = elem->zone_append_lba;
+	if (compl)
+		__ublk_complete_rq(req);
+	return 0;
+}
+
+static int ublk_batch_commit(struct io_uring_cmd *cmd, struct ublk_queue *ubq,
+			     const struct ublk_batch_io *uc,
+			     unsigned int issue_flags)
+{
+	const struct ublk_batch_commit_elem __user *uelem =
+		u64_to_user_ptr(uc->addr);
+	struct ublk_batch_commit_elem elem[UBLK_BATCH_COMMIT_CHUNK];
+	unsigned int i, nr, done = 0;
+	int ret;
+
+	if (uc->flags & ~UBLK_BATCH_F_MASK)
+		return -EINVAL;
+
+	while (done < uc->nr_elem) {
+		nr = min_t(unsigned int, uc->nr_elem - done, ARRAY_SIZE(elem));
+		if (copy_from_user(elem, uelem + done, nr * sizeof(*elem)))
+			return done ? done : -EFAULT;
+
+		for (i = 0; i < nr; i++) {
+			ret = ublk_batch_commit_one(cmd, ubq, &elem[i],
+						    uc->flags, issue_flags);
+			if (ret)
+				return done ? done : ret;
+			done++;
+		}
+	}
+	return done;
+}
+
+static int ublk_batch_uring_cmd(struct io_uring_cmd *cmd,
+				unsigned int issue_flags)
+{
+	const struct ublk_batch_io *uc_src = io_uring_sqe_cmd(cmd->sqe);
+	const struct ublk_batch_io uc = {
+		.q_id = READ_ONCE(uc_src->q_id),
+		.flags = READ_ONCE(uc_src->flags),
+		.nr_elem = READ_ONCE(uc_src->nr_elem),
+		.addr = READ_ONCE(uc_src->addr),
+	};
+	struct ublk_device *ub = cmd->file->private_data;
+	struct ublk_queue *ubq;
+
+	if (uc.q_id >= ub->dev_info.nr_hw_queues)
+		return -EINVAL;
+
+	ubq = ublk_get_queue(ub, uc.q_id);
+	if (!ublk_support_batch_io(ubq))
+		return -EOPNOTSUPP;
+
+	if (cmd->cmd_op == UBLK_U_IO_FETCH_IO_CMDS)
+		return ublk_batch_fetch(cmd, ubq, &uc, issue_flags);
+	return ublk_batch_commit(cmd, ubq, &uc, issue_flags);
+}
+
 static inline int ublk_ch_uring_cmd_local(struct io_uring_cmd *cmd,
 		unsigned int issue_flags)
 {
@@ -2511,6 +2881,10 @@ static inline int ublk_ch_uring_cmd_local(struct io_uring_cmd *cmd,
 
 	WARN_ON_ONCE(issue_flags & IO_URING_F_UNLOCKED);
 
+	if (cmd->cmd_op == UBLK_U_IO_FETCH_IO_CMDS ||
+	    cmd->cmd_op == UBLK_U_IO_COMMIT_IO_CMDS)
+		return ublk_batch_uring_cmd(cmd, issue_flags);
+
 	return __ublk_ch_uring_cmd(cmd, issue_flags, &ub_cmd);
 }
 
@@ -2670,6 +3044,8 @@ static void ublk_deinit_queue(struct ublk_device *ub, int q_id)
 
 	if (ubq->io_cmd_buf)
 		free_pages((unsigned long)ubq->io_cmd_buf, get_order(size));
+	kfifo_free(&ubq->evts_fifo);
+	kfree(ubq->batch_tags);
 }
 
 static int ublk_init_queue(struct ublk_device *ub, int q_id)
@@ -2680,11 +3056,21 @@ static int ublk_init_queue(struct ublk_device *ub, int q_id)
 	int size;
 
 	spin_lock_init(&ubq->cancel_lock);
+	spin_lock_init(&ubq->batch_lock);
 	ubq->flags = ub->dev_info.flags;
 	ubq->q_id = q_id;
 	ubq->q_depth = ub->dev_info.queue_depth;
 	size = ublk_queue_cmd_buf_size(ub, q_id);
 
+	if (ublk_support_batch_io(ubq)) {
+		if (kfifo_alloc(&ubq->evts_fifo, ubq->q_depth, GFP_KERNEL))
+			return -ENOMEM;
+		ubq->batch_tags = kcalloc(ubq->q_depth,
+					  sizeof(*ubq->batch_tags), GFP_KERNEL);
+		if (!ubq->batch_tags)
+			return -ENOMEM;
+	}
+
 	ptr = (void *) __get_free_pages(gfp_flags, get_order(size));
 	if (!ptr)
 		return -ENOMEM;
@@ -3156,6 +3542,18 @@ static int ublk_ctrl_add_dev(const struct ublksrv_ctrl_cmd *header)
 				UBLK_F_AUTO_BUF_REG))
 		ub->dev_info.flags &= ~UBLK_F_NEED_GET_DATA;
 
+	/*
+	 * Batched IO commands don't carry per-IO buffer addresses, and the
+	 * recovery features rely on per-IO commands for re-fetching
+	 */
+	if ((ub->dev_info.flags & UBLK_F_BATCH_IO) &&
+	    (!(ub->dev_info.flags & (UBLK_F_USER_COPY |
+	       UBLK_F_SUPPORT_ZERO_COPY | UBLK_F_AUTO_BUF_REG)) ||
+	     (ub->dev_info.flags & UBLK_F_ALL_RECOVERY_FLAGS))) {
+		ret = -EINVAL;
+		goto out_free_dev_number;
+	}
+
 	/*
 	 * Zoned storage support requires reuse `ublksrv_io_cmd->addr` for
 	 * returning write_append_lba, which is only allowed in case of
@@ -50,6 +50,12 @@ struct virtio_blk_vq {
 	struct virtqueue *vq;
 	spinlock_t lock;
 	char name[VQ_NAME_LEN];
+
+	/* Statistics, updated under @lock */
+	unsigned long nr_reqs;		/* requests added to the vq */
+	unsigned long nr_kicks;		/* host notifications */
+	unsigned long nr_irqs;		/* vq callbacks */
+	unsigned long nr_irq_completions; /* requests completed by callbacks */
 } ____cacheline_aligned_in_smp;
 
 struct virtio_blk {
@@ -347,6 +353,17 @@ static inline void virtblk_request_done(struct request *req)
 	blk_mq_end_request(req, status);
 }
 
+static void virtblk_complete_batch(struct io_comp_batch *iob)
+{
+	struct request *req;
+
+	rq_list_for_each(&iob->req_list, req) {
+		virtblk_unmap_data(req, blk_mq_rq_to_pdu(req));
+		virtblk_cleanup_cmd(req);
+	}
+	blk_mq_end_request_batch(iob);
+}
+
 static void virtblk_done(struct virtqueue *vq)
 {
 	struct virtio_blk *vblk = vq->vdev->priv;
@@ -355,16 +372,32 @@ static void virtblk_done(struct virtqueue *vq)
 	struct virtblk_req *vbr;
 	unsigned long flags;
 	unsigned int len;
+	DEFINE_IO_COMP_BATCH(iob);
 
 	spin_lock_irqsave(&vblk->vqs[qid].lock, flags);
+	vblk->vqs[qid].nr_irqs++;
 	do {
 		virtqueue_disable_cb(vq);
 		while ((vbr = virtqueue_get_buf(vblk->vqs[qid].vq, &len)) != NULL) {
 			struct request *req = blk_mq_rq_from_pdu(vbr);
 
-			if (likely(!blk_should_fake_timeout(req->q)))
-				blk_mq_complete_request(req);
+			vblk->vqs[qid].nr_irq_completions++;
 			req_done = true;
+			if (unlikely(blk_should_fake_timeout(req->q)))
+				continue;
+
+			if (blk_mq_complete_request_remote(req))
+				continue;
+
+			/*
+			 * Zone append needs the written sector from
+			 * virtblk_request_done(), don't batch it.
+			 */
+			if (req_op(req) == REQ_OP_ZONE_APPEND ||
+			    !blk_mq_add_to_batch(req, &iob,
+					virtblk_vbr_status(vbr) != VIRTIO_BLK_S_OK,
+					virtblk_complete_batch))
+				virtblk_request_done(req);
 		}
 	} while (!virtqueue_enable_cb(vq));
 
@@ -372,6 +405,9 @@ static void virtblk_done(struct virtqueue *vq)
 	if (req_done)
 		blk_mq_start_stopped_hw_queues(vblk->disk->queue, true);
 	spin_unlock_irqrestore(&vblk->vqs[qid].lock, flags);
+
+	if (!rq_list_empty(&iob.req_list))
+		iob.complete(&iob);
 }
 
 static void virtio_commit_rqs(struct blk_mq_hw_ctx *hctx)
@@ -382,6 +418,8 @@ static void virtio_commit_rqs(struct blk_mq_hw_ctx *hctx)
 
 	spin_lock_irq(&vq->lock);
 	kick = virtqueue_kick_prepare(vq->vq);
+	if (kick)
+		vq->nr_kicks++;
 	spin_unlock_irq(&vq->lock);
 
 	if (kick)
@@ -453,8 +491,11 @@ static blk_status_t virtio_queue_rq(struct blk_mq_hw_ctx *hctx,
 		return virtblk_fail_to_queue(req, err);
 	}
 
-	if (bd->last && virtqueue_kick_prepare(vblk->vqs[qid].vq))
+	vblk->vqs[qid].nr_reqs++;
+	if (bd->last && virtqueue_kick_prepare(vblk->vqs[qid].vq)) {
+		vblk->vqs[qid].nr_kicks++;
 		notify = true;
+	}
 	spin_unlock_irqrestore(&vblk->vqs[qid].lock, flags);
 
 	if (notify)
@@ -488,10 +529,14 @@ static void virtblk_add_req_batch(struct virtio_blk_vq *vq,
 			virtblk_unmap_data(req, vbr);
 			virtblk_cleanup_cmd(req);
 			blk_mq_requeue_request(req, true);
+			continue;
 		}
+		vq->nr_reqs++;
 	}
 
 	kick = virtqueue_kick_prepare(vq->vq);
+	if (kick)
+		vq->nr_kicks++;
 	spin_unlock_irqrestore(&vq->lock, flags);
 
 	if (kick)
@@ -908,6 +953,32 @@ static ssize_t serial_show(struct device *dev,
 
 static DEVICE_ATTR_RO(serial);
 
+/*
+ * One line per virtqueue: name, requests added, host notifications, vq
+ * callbacks and requests completed from callbacks.
+ */
+static ssize_t vq_stats_show(struct device *dev,
+			     struct device_attribute *attr, char *buf)
+{
+	struct gendisk *disk = dev_to_disk(dev);
+	struct virtio_blk *vblk = disk->private_data;
+	ssize_t len = 0;
+	int i;
+
+	for (i = 0; i < vblk->num_vqs; i++) {
+		struct virtio_blk_vq *vq = &vblk->vqs[i];
+
+		len += sysfs_emit_at(buf, len, "%s %lu %lu %lu %lu\n", vq->name,
+				     READ_ONCE(vq->nr_reqs),
+				     READ_ONCE(vq->nr_kicks),
+				     READ_ONCE(vq->nr_irqs),
+				     READ_ONCE(vq->nr_irq_completions));
+	}
+	return len;
+}
+
+static DEVICE_ATTR_RO(vq_stats);
+
 /* The queue's logical block size must be set before calling this */
 static void virtblk_update_capacity(struct virtio_blk *vblk, bool resize)
 {
@@ -1126,6 +1197,7 @@ static DEVICE_ATTR_RW(cache_type);
 static struct attribute *virtblk_attrs[] = {
 	&dev_attr_serial.attr,
 	&dev_attr_cache_type.attr,
+	&dev_attr_vq_stats.attr,
 	NULL,
 };
 
@@ -1182,17 +1254,6 @@ static void virtblk_map_queues(struct blk_mq_tag_set *set)
 	}
 }
 
-static void virtblk_complete_batch(struct io_comp_batch *iob)
-{
-	struct request *req;
-
-	rq_list_for_each(&iob->req_list, req) {
-		virtblk_unmap_data(req, blk_mq_rq_to_pdu(req));
-		virtblk_cleanup_cmd(req);
-	}
-	blk_mq_end_request_batch(iob);
-}
-
 static int virtblk_poll(struct blk_mq_hw_ctx *hctx, struct io_comp_batch *iob)
 {
 	struct virtio_blk *vblk = hctx->queue->queuedata;
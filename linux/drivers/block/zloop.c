@@ -92,10 +92,24 @@ struct zloop_zone {
 
 	unsigned long		flags;
 	struct mutex		lock;
+	/*
+	 * Protects cond and wp. Updates are also serialized by the zone mutex,
+	 * the spinlock lets zone reports read them without waiting for writes
+	 * being issued to the zone file.
+	 */
+	spinlock_t		wp_lock;
 	enum blk_zone_cond	cond;
 	sector_t		start;
 	sector_t		wp;
 
+	/*
+	 * Writes issued to a sequential zone file and not yet completed. Zone
+	 * reset, finish and write pointer recovery wait for these to drain, so
+	 * that they never truncate or rewind the zone under a write.
+	 */
+	atomic_t		nr_inflight_writes;
+	wait_queue_head_t	inflight_wait;
+
 	gfp_t			old_gfp_mask;
 };
 
@@ -130,6 +144,7 @@ struct zloop_cmd {
 	long			ret;
 	struct kiocb		iocb;
 	struct bio_vec		*bvec;
+	bool			seq_write;
 };
 
 static DEFINE_IDR(zloop_index_idr);
@@ -142,6 +157,14 @@ static unsigned int rq_zone_no(struct request *rq)
 	return blk_rq_pos(rq) >> zlo->zone_shift;
 }
 
+static void zloop_wait_inflight_writes(struct zloop_zone *zone)
+{
+	lockdep_assert_held(&zone->lock);
+
+	wait_event(zone->inflight_wait,
+		   !atomic_read(&zone->nr_inflight_writes));
+}
+
 static int zloop_update_seq_zone(struct zloop_device *zlo, unsigned int zone_no)
 {
 	struct zloop_zone *zone = &zlo->zones[zone_no];
@@ -151,6 +174,8 @@ static int zloop_update_seq_zone(struct zloop_device *zlo, unsigned int zone_no)
 
 	lockdep_assert_held(&zone->lock);
 
+	zloop_wait_inflight_writes(zone);
+
 	ret = vfs_getattr(&zone->file->f_path, &stat, STATX_SIZE, 0);
 	if (ret < 0) {
 		pr_err("Failed to get zone %u file stat (err=%d)\n",
@@ -172,6 +197,7 @@ static int zloop_update_seq_zone(struct zloop_device *zlo, unsigned int zone_no)
 		return -EINVAL;
 	}
 
+	spin_lock(&zone->wp_lock);
 	if (!file_sectors) {
 		zone->cond = BLK_ZONE_COND_EMPTY;
 		zone->wp = zone->start;
@@ -182,6 +208,7 @@ static int zloop_update_seq_zone(struct zloop_device *zlo, unsigned int zone_no)
 		zone->cond = BLK_ZONE_COND_CLOSED;
 		zone->wp = zone->start + file_sectors;
 	}
+	spin_unlock(&zone->wp_lock);
 
 	return 0;
 }
@@ -202,6 +229,7 @@ static int zloop_open_zone(struct zloop_device *zlo, unsigned int zone_no)
 			goto unlock;
 	}
 
+	spin_lock(&zone->wp_lock);
 	switch (zone->cond) {
 	case BLK_ZONE_COND_EXP_OPEN:
 		break;
@@ -215,6 +243,7 @@ static int zloop_open_zone(struct zloop_device *zlo, unsigned int zone_no)
 		ret = -EIO;
 		break;
 	}
+	spin_unlock(&zone->wp_lock);
 
 unlock:
 	mutex_unlock(&zone->lock);
@@ -238,6 +267,7 @@ static int zloop_close_zone(struct zloop_device *zlo, unsigned int zone_no)
 			goto unlock;
 	}
 
+	spin_lock(&zone->wp_lock);
 	switch (zone->cond) {
 	case BLK_ZONE_COND_CLOSED:
 		break;
@@ -254,6 +284,7 @@ static int zloop_close_zone(struct zloop_device *zlo, unsigned int zone_no)
 		ret = -EIO;
 		break;
 	}
+	spin_unlock(&zone->wp_lock);
 
 unlock:
 	mutex_unlock(&zone->lock);
@@ -275,14 +306,17 @@ static int zloop_reset_zone(struct zloop_device *zlo, unsigned int zone_no)
 	    zone->cond == BLK_ZONE_COND_EMPTY)
 		goto unlock;
 
+	zloop_wait_inflight_writes(zone);
 	if (vfs_truncate(&zone->file->f_path, 0)) {
 		set_bit(ZLOOP_ZONE_SEQ_ERROR, &zone->flags);
 		ret = -EIO;
 		goto unlock;
 	}
 
+	spin_lock(&zone->wp_lock);
 	zone->cond = BLK_ZONE_COND_EMPTY;
 	zone->wp = zone->start;
+	spin_unlock(&zone->wp_lock);
 	clear_bit(ZLOOP_ZONE_SEQ_ERROR, &zone->flags);
 
 unlock:
@@ -319,14 +353,17 @@ static int zloop_finish_zone(struct zloop_device *zlo, unsigned int zone_no)
 	    zone->cond == BLK_ZONE_COND_FULL)
 		goto unlock;
 
+	zloop_wait_inflight_writes(zone);
 	if (vfs_truncate(&zone->file->f_path, zlo->zone_size << SECTOR_SHIFT)) {
 		set_bit(ZLOOP_ZONE_SEQ_ERROR, &zone->flags);
 		ret = -EIO;
 		goto unlock;
 	}
 
+	spin_lock(&zone->wp_lock);
 	zone->cond = BLK_ZONE_COND_FULL;
 	zone->wp = zone->start + zlo->zone_size;
+	spin_unlock(&zone->wp_lock);
 	clear_bit(ZLOOP_ZONE_SEQ_ERROR, &zone->flags);
 
  unlock:
@@ -351,6 +388,16 @@ static void zloop_rw_complete(struct kiocb *iocb, long ret)
 {
 	struct zloop_cmd *cmd = container_of(iocb, struct zloop_cmd, iocb);
 
+	if (cmd->seq_write) {
+		struct request *rq = blk_mq_rq_from_pdu(cmd);
+		struct zloop_device *zlo = rq->q->queuedata;
+		struct zloop_zone *zone = &zlo->zones[rq_zone_no(rq)];
+
+		cmd->seq_write = false;
+		if (atomic_dec_and_test(&zone->nr_inflight_writes))
+			wake_up(&zone->inflight_wait);
+	}
+
 	cmd->ret = ret;
 	zloop_put_cmd(cmd);
 }
@@ -377,6 +424,7 @@ static void zloop_rw(struct zloop_cmd *cmd)
 	cmd->sector = sector;
 	cmd->nr_sectors = nr_sectors;
 	cmd->ret = 0;
+	cmd->seq_write = false;
 
 	/* We should never get an I/O beyond the device capacity. */
 	if (WARN_ON_ONCE(zone_no >= zlo->nr_zones)) {
@@ -404,7 +452,13 @@ static void zloop_rw(struct zloop_cmd *cmd)
 	}
 
 	if (!test_bit(ZLOOP_ZONE_CONV, &zone->flags) && is_write) {
+		/*
+		 * Hold the zone mutex until the write is issued so that writes
+		 * reach the zone file in write pointer order. Direct I/O writes
+		 * are issued asynchronously, so several can still be in flight.
+		 */
 		mutex_lock(&zone->lock);
+		spin_lock(&zone->wp_lock);
 
 		if (is_append) {
 			sector = zone->wp;
@@ -418,6 +472,7 @@ static void zloop_rw(struct zloop_cmd *cmd)
 		if (sector != zone->wp || zone->wp + nr_sectors > zone_end) {
 			pr_err("Zone %u: unaligned write: sect %llu, wp %llu\n",
 			       zone_no, sector, zone->wp);
+			spin_unlock(&zone->wp_lock);
 			ret = -EIO;
 			goto unlock;
 		}
@@ -435,6 +490,8 @@ static void zloop_rw(struct zloop_cmd *cmd)
 		zone->wp += nr_sectors;
 		if (zone->wp == zone_end)
 			zone->cond = BLK_ZONE_COND_FULL;
+
+		spin_unlock(&zone->wp_lock);
 	}
 
 	rq_for_each_bvec(tmp, rq, rq_iter)
@@ -480,6 +537,11 @@ static void zloop_rw(struct zloop_cmd *cmd)
 		cmd->iocb.ki_flags = IOCB_DIRECT;
 	cmd->iocb.ki_ioprio = IOPRIO_PRIO_VALUE(IOPRIO_CLASS_NONE, 0);
 
+	if (!test_bit(ZLOOP_ZONE_CONV, &zone->flags) && is_write) {
+		atomic_inc(&zone->nr_inflight_writes);
+		cmd->seq_write = true;
+	}
+
 	if (rw == ITER_SOURCE)
 		ret = zone->file->f_op->write_iter(&cmd->iocb, &iter);
 	else
@@ -663,20 +725,30 @@ static int zloop_report_zones(struct gendisk *disk, sector_t sector,
 		unsigned int zone_no = first + i;
 		struct zloop_zone *zone = &zlo->zones[zone_no];
 
-		mutex_lock(&zone->lock);
-
-		if (test_and_clear_bit(ZLOOP_ZONE_SEQ_ERROR, &zone->flags)) {
-			ret = zloop_update_seq_zone(zlo, zone_no);
-			if (ret) {
-				mutex_unlock(&zone->lock);
-				return ret;
+		/*
+		 * Only recovering the write pointer needs the zone mutex, the
+		 * cached cond and wp are read under wp_lock so that reports
+		 * don't wait for writes being issued to the zone file.
+		 */
+		if (test_bit(ZLOOP_ZONE_SEQ_ERROR, &zone->flags)) {
+			mutex_lock(&zone->lock);
+			if (test_and_clear_bit(ZLOOP_ZONE_SEQ_ERROR,
+					       &zone->flags)) {
+				ret = zloop_update_seq_zone(zlo, zone_no);
+				if (ret) {
+					mutex_unlock(&zone->lock);
+					return ret;
+				}
 			}
+			mutex_unlock(&zone->lock);
 		}
 
 		blkz.start = zone->start;
 		blkz.len = zlo->zone_size;
+		spin_lock(&zone->wp_lock);
 		blkz.wp = zone->wp;
 		blkz.cond = zone->cond;
+		spin_unlock(&zone->wp_lock);
 		if (test_bit(ZLOOP_ZONE_CONV, &zone->flags)) {
 			blkz.type = BLK_ZONE_TYPE_CONVENTIONAL;
 			blkz.capacity = zlo->zone_size;
@@ -685,8 +757,6 @@ static int zloop_report_zones(struct gendisk *disk, sector_t sector,
 			blkz.capacity = zlo->zone_capacity;
 		}
 
-		mutex_unlock(&zone->lock);
-
 		ret = cb(&blkz, i, data);
 		if (ret)
 			return ret;
@@ -783,6 +853,9 @@ static int zloop_init_zone(struct zloop_device *zlo, struct zloop_options *opts,
 	int ret;
 
 	mutex_init(&zone->lock);
+	spin_lock_init(&zone->wp_lock);
+	atomic_set(&zone->nr_inflight_writes, 0);
+	init_waitqueue_head(&zone->inflight_wait);
 	zone->start = (sector_t)zone_no << zlo->zone_shift;
 
 	if (!restore)
@@ -972,17 +972,15 @@ static struct bset_search_iter bset_search_tree(struct bset_tree *t,
 		j = n;
 		f = &t->tree[j];
 
-		if (likely(f->exponent != 127)) {
-			if (f->mantissa >= bfloat_mantissa(search, f))
-				n = j * 2;
-			else
-				n = j * 2 + 1;
-		} else {
-			if (bkey_cmp(tree_to_bkey(t, j), search) > 0)
-				n = j * 2;
-			else
-				n = j * 2 + 1;
-		}
+		/*
+		 * Which child we descend to is data dependent and effectively
+		 * random, so compute it rather than branch on it - a
+		 * mispredict here costs more than the comparison itself.
+		 */
+		if (likely(f->exponent != 127))
+			n = j * 2 + (f->mantissa < bfloat_mantissa(search, f));
+		else
+			n = j * 2 + (bkey_cmp(tree_to_bkey(t, j), search) <= 0);
 	} while (n < t->size);
 
 	inorder = to_inorder(j, t);
@@ -20,6 +20,7 @@
 #include <linux/rbtree.h>
 #include <linux/stacktrace.h>
 #include <linux/jump_label.h>
+#include <linux/percpu.h>
 
 #include "dm.h"
 
@@ -1075,6 +1076,24 @@ static LIST_HEAD(dm_bufio_all_clients);
  */
 static DEFINE_MUTEX(dm_bufio_clients_lock);
 
+/*
+ * Statistics of all clients: lookups that found the block cached, lookups
+ * that had to read it (or failed a dm_bufio_get) and buffers evicted.
+ */
+enum {
+	DM_BUFIO_STAT_HIT,
+	DM_BUFIO_STAT_MISS,
+	DM_BUFIO_STAT_EVICT,
+	DM_BUFIO_NR_STATS,
+};
+
+static DEFINE_PER_CPU(unsigned long, dm_bufio_stats[DM_BUFIO_NR_STATS]);
+
+static inline void dm_bufio_stat_inc(unsigned int stat)
+{
+	this_cpu_inc(dm_bufio_stats[stat]);
+}
+
 static struct workqueue_struct *dm_bufio_wq;
 static struct work_struct dm_bufio_replacement_work;
 
@@ -1535,6 +1554,7 @@ static struct dm_buffer *__get_unclaimed_buffer(struct dm_bufio_client *c)
 
 	b = cache_evict(&c->cache, LIST_CLEAN, is_clean, c);
 	if (b) {
+		dm_bufio_stat_inc(DM_BUFIO_STAT_EVICT);
 		/* this also waits for pending reads */
 		__make_buffer_clean(b);
 		return b;
@@ -1545,6 +1565,7 @@ static struct dm_buffer *__get_unclaimed_buffer(struct dm_bufio_client *c)
 
 	b = cache_evict(&c->cache, LIST_DIRTY, is_dirty, NULL);
 	if (b) {
+		dm_bufio_stat_inc(DM_BUFIO_STAT_EVICT);
 		__make_buffer_clean(b);
 		return b;
 	}
@@ -1874,6 +1895,8 @@ static void *new_read(struct dm_bufio_client *c, sector_t block,
 			return NULL;
 		}
 
+		dm_bufio_stat_inc(DM_BUFIO_STAT_HIT);
+
 		/*
 		 * Note: it is essential that we don't wait for the buffer to be
 		 * read if dm_bufio_get function is used. Both dm_bufio_get and
@@ -1888,8 +1911,10 @@ static void *new_read(struct dm_bufio_client *c, sector_t block,
 	}
 
 	if (!b) {
-		if (nf == NF_GET)
+		if (nf == NF_GET) {
+			dm_bufio_stat_inc(DM_BUFIO_STAT_MISS);
 			return NULL;
+		}
 
 		dm_bufio_lock(c);
 		b = __bufio_new(c, block, nf, &need_submit, &write_list);
@@ -1906,8 +1931,11 @@ static void *new_read(struct dm_bufio_client *c, sector_t block,
 	if (!b)
 		return NULL;
 
-	if (need_submit)
+	if (need_submit) {
+		if (nf == NF_READ)
+			dm_bufio_stat_inc(DM_BUFIO_STAT_MISS);
 		submit_io(b, REQ_OP_READ, ioprio, read_endio);
+	}
 
 	if (nf != NF_GET)	/* we already tested this condition above */
 		wait_on_bit_io(&b->state, B_READING, TASK_UNINTERRUPTIBLE);
@@ -2407,6 +2435,7 @@ static void __scan(struct dm_bufio_client *c)
 					l == LIST_CLEAN ? is_clean : is_dirty, c);
 			if (!b)
 				break;
+			dm_bufio_stat_inc(DM_BUFIO_STAT_EVICT);
 
 			__make_buffer_clean(b);
 			__free_buffer_wake(b);
@@ -2734,6 +2763,7 @@ static unsigned long __evict_a_few(unsigned long nr_buffers)
 		b = cache_evict(&c->cache, LIST_CLEAN, select_for_evict, NULL);
 		if (!b)
 			break;
+		dm_bufio_stat_inc(DM_BUFIO_STAT_EVICT);
 
 		last_accessed = READ_ONCE(b->last_accessed);
 		if (time_after_eq(oldest_buffer, last_accessed))
@@ -2906,6 +2936,38 @@ MODULE_PARM_DESC(allocated_vmalloc_bytes, "Memory allocated with vmalloc");
 module_param_named(current_allocated_bytes, dm_bufio_current_allocated, ulong, 0444);
 MODULE_PARM_DESC(current_allocated_bytes, "Memory currently used by the cache");
 
+static unsigned int dm_bufio_stat_idx[DM_BUFIO_NR_STATS] = {
+	DM_BUFIO_STAT_HIT, DM_BUFIO_STAT_MISS, DM_BUFIO_STAT_EVICT,
+};
+
+static int dm_bufio_stat_get(char *buffer, const struct kernel_param *kp)
+{
+	unsigned int stat = *(unsigned int *)kp->arg;
+	unsigned long sum = 0;
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+		sum += per_cpu(dm_bufio_stats[stat], cpu);
+
+	return sysfs_emit(buffer, "%lu\n", sum);
+}
+
+static const struct kernel_param_ops dm_bufio_stat_ops = {
+	.get = dm_bufio_stat_get,
+};
+
+module_param_cb(buffer_hits, &dm_bufio_stat_ops,
+		&dm_bufio_stat_idx[DM_BUFIO_STAT_HIT], 0444);
+MODULE_PARM_DESC(buffer_hits, "Buffer lookups served from the cache");
+
+module_param_cb(buffer_misses, &dm_bufio_stat_ops,
+		&dm_bufio_stat_idx[DM_BUFIO_STAT_MISS], 0444);
+MODULE_PARM_DESC(buffer_misses, "Buffer lookups that had to read the block");
+
+module_param_cb(buffer_evictions, &dm_bufio_stat_ops,
+		&dm_bufio_stat_idx[DM_BUFIO_STAT_EVICT], 0444);
+MODULE_PARM_DESC(buffer_evictions, "Buffers evicted from the cache");
+
 MODULE_AUTHOR("Mikulas Patocka <dm-devel@lists.linux.dev>");
 MODULE_DESCRIPTION(DM_NAME " buffered I/O library");
 MODULE_LICENSE("GPL");
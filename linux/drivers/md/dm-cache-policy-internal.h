@@ -104,6 +104,12 @@ static inline int policy_set_config_value(struct dm_cache_policy *p,
 	return p->set_config_value ? p->set_config_value(p, key, value) : -EINVAL;
 }
 
+static inline int policy_emit_stats(struct dm_cache_policy *p, char *result,
+				    unsigned int maxlen, ssize_t *sz_ptr)
+{
+	return p->emit_stats ? p->emit_stats(p, result, maxlen, sz_ptr) : -EINVAL;
+}
+
 static inline void policy_allow_migrations(struct dm_cache_policy *p, bool allow)
 {
 	return p->allow_migrations(p, allow);
@@ -855,6 +855,15 @@ struct smq_policy {
 	unsigned long next_hotspot_period;
 	unsigned long next_cache_period;
 
+	/*
+	 * Promotions cost writes to the fast device.  If promote_budget is
+	 * set we queue at most that many promotions per hotspot period.
+	 */
+	unsigned int promote_budget;
+	unsigned int period_promotions;
+	unsigned long nr_promotions;
+	unsigned long nr_throttled_promotions;
+
 	struct background_tracker *bg_work;
 
 	bool migrations_allowed:1;
@@ -1108,6 +1117,7 @@ static void end_hotspot_period(struct smq_policy *mq)
 		update_level_jump(mq);
 		q_redistribute(&mq->hotspot);
 		stats_reset(&mq->hotspot_stats);
+		mq->period_promotions = 0;
 		mq->next_hotspot_period = jiffies + HOTSPOT_UPDATE_PERIOD;
 	}
 }
@@ -1257,6 +1267,11 @@ static void queue_promotion(struct smq_policy *mq, dm_oblock_t oblock,
 	if (btracker_promotion_already_present(mq->bg_work, oblock))
 		return;
 
+	if (mq->promote_budget && mq->period_promotions >= mq->promote_budget) {
+		mq->nr_throttled_promotions++;
+		return;
+	}
+
 	/*
 	 * We allocate the entry now to reserve the cblock.  If the
 	 * background work is aborted we must remember to free it.
@@ -1268,8 +1283,13 @@ static void queue_promotion(struct smq_policy *mq, dm_oblock_t oblock,
 	work.oblock = oblock;
 	work.cblock = infer_cblock(mq, e);
 	r = btracker_queue(mq->bg_work, &work, workp);
-	if (r)
+	if (r) {
 		free_entry(&mq->cache_alloc, e);
+		return;
+	}
+
+	mq->period_promotions++;
+	mq->nr_promotions++;
 }
 
 /*----------------------------------------------------------------*/
@@ -1644,8 +1664,76 @@ static void smq_allow_migrations(struct dm_cache_policy *p, bool allow)
 	mq->migrations_allowed = allow;
 }
 
+static int smq_set_config_value(struct dm_cache_policy *p,
+				const char *key, const char *value)
+{
+	unsigned int tmp;
+	unsigned long flags;
+	struct smq_policy *mq = to_smq_policy(p);
+
+	if (strcasecmp(key, "promote_budget"))
+		return -EINVAL;
+
+	if (kstrtouint(value, 10, &tmp))
+		return -EINVAL;
+
+	spin_lock_irqsave(&mq->lock, flags);
+	mq->promote_budget = tmp;
+	spin_unlock_irqrestore(&mq->lock, flags);
+
+	return 0;
+}
+
+/*
+ * Without a budget the status line ends in "0", as it always has.
+ */
+static int smq_emit_config_values(struct dm_cache_policy *p, char *result,
+				  unsigned int maxlen, ssize_t *sz_ptr)
+{
+	ssize_t sz = *sz_ptr;
+	struct smq_policy *mq = to_smq_policy(p);
+	unsigned int promote_budget = READ_ONCE(mq->promote_budget);
+
+	if (promote_budget)
+		DMEMIT("2 promote_budget %u ", promote_budget);
+	else
+		DMEMIT("0 ");
+
+	*sz_ptr = sz;
+	return 0;
+}
+
 /*
- * smq has no config values, but the old mq policy did.  To avoid breaking
+ * Read-only counters, reported through the "policy_stats" message so that
+ * they never end up in the settable config values of the status line.
+ * The hotspot hit ratio covers the current hotspot period.
+ */
+static int smq_emit_stats(struct dm_cache_policy *p, char *result,
+			  unsigned int maxlen, ssize_t *sz_ptr)
+{
+	ssize_t sz = *sz_ptr;
+	unsigned long flags;
+	unsigned int hits, misses;
+	unsigned long nr_promotions, nr_throttled;
+	struct smq_policy *mq = to_smq_policy(p);
+
+	spin_lock_irqsave(&mq->lock, flags);
+	hits = mq->hotspot_stats.hits;
+	misses = mq->hotspot_stats.misses;
+	nr_promotions = mq->nr_promotions;
+	nr_throttled = mq->nr_throttled_promotions;
+	spin_unlock_irqrestore(&mq->lock, flags);
+
+	DMEMIT("promotions %lu throttled_promotions %lu hotspot_hit_permille %u",
+	       nr_promotions, nr_throttled,
+	       (unsigned int) div_u64((u64) hits * 1000u, max(hits + misses, 1u)));
+
+	*sz_ptr = sz;
+	return 0;
+}
+
+/*
+ * The old mq policy had its own config values.  To avoid breaking
  * software we continue to accept these configurables for the mq policy,
  * but they have no effect.
  */
@@ -1700,10 +1788,14 @@ static void init_policy_functions(struct smq_policy *mq, bool mimic_mq)
 	mq->policy.residency = smq_residency;
 	mq->policy.tick = smq_tick;
 	mq->policy.allow_migrations = smq_allow_migrations;
+	mq->policy.emit_stats = smq_emit_stats;
 
 	if (mimic_mq) {
 		mq->policy.set_config_value = mq_set_config_value;
 		mq->policy.emit_config_values = mq_emit_config_values;
+	} else {
+		mq->policy.set_config_value = smq_set_config_value;
+		mq->policy.emit_config_values = smq_emit_config_values;
 	}
 }
 
@@ -1865,7 +1957,7 @@ static struct dm_cache_policy *cleaner_create(dm_cblock_t cache_size,
 
 static struct dm_cache_policy_type smq_policy_type = {
 	.name = "smq",
-	.version = {2, 0, 0},
+	.version = {2, 1, 0},
 	.hint_size = 4,
 	.owner = THIS_MODULE,
 	.create = smq_create
@@ -1889,7 +1981,7 @@ static struct dm_cache_policy_type cleaner_policy_type = {
 
 static struct dm_cache_policy_type default_policy_type = {
 	.name = "default",
-	.version = {2, 0, 0},
+	.version = {2, 1, 0},
 	.hint_size = 4,
 	.owner = THIS_MODULE,
 	.create = smq_create,
@@ -133,6 +133,14 @@ struct dm_cache_policy {
 	int (*set_config_value)(struct dm_cache_policy *p,
 				const char *key, const char *value);
 
+	/*
+	 * Read-only statistics, returned by the "policy_stats" message.
+	 *
+	 * This method is optional.
+	 */
+	int (*emit_stats)(struct dm_cache_policy *p, char *result,
+			  unsigned int maxlen, ssize_t *sz_ptr);
+
 	void (*allow_migrations)(struct dm_cache_policy *p, bool allow);
 
 	/*
@@ -3406,6 +3406,8 @@ static int process_invalidate_cblocks_message(struct cache *cache, unsigned int
  *	"<key> <value>"
  * and
  *     "invalidate_cblocks [(<begin>)|(<begin>-<end>)]*
+ * and
+ *	"policy_stats", which returns the policy's read-only statistics
  *
  * The key migration_threshold is supported by the cache target core.
  */
@@ -3417,6 +3419,17 @@ static int cache_message(struct dm_target *ti, unsigned int argc, char **argv,
 	if (!argc)
 		return -EINVAL;
 
+	if (!strcasecmp(argv[0], "policy_stats")) {
+		ssize_t sz = 0;
+		int r;
+
+		if (argc != 1)
+			return -EINVAL;
+
+		r = policy_emit_stats(cache->policy, result, maxlen, &sz);
+		return r ? r : 1;
+	}
+
 	if (get_cache_mode(cache) >= CM_READ_ONLY) {
 		DMERR("%s: unable to service cache target messages in READ_ONLY or FAIL mode",
 		      cache_device_name(cache));
@@ -3516,7 +3529,7 @@ static void cache_io_hints(struct dm_target *ti, struct queue_limits *limits)
 
 static struct target_type cache_target = {
 	.name = "cache",
-	.version = {2, 3, 0},
+	.version = {2, 4, 0},
 	.module = THIS_MODULE,
 	.ctr = cache_ctr,
 	.dtr = cache_dtr,
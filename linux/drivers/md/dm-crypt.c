@@ -151,6 +151,16 @@ enum cipher_flags {
 	CRYPT_KEY_MAC_SIZE_SET,		/* The integrity_key_size option was used */
 };
 
+/*
+ * Per-cpu conversion statistics, indexed by data direction. @ns is the time
+ * spent in crypt_convert(), which for asynchronous ciphers only covers
+ * submitting the crypto requests.
+ */
+struct crypt_stats {
+	u64 bytes[2];
+	u64 ns[2];
+};
+
 /*
  * The fields in here must be read only after initialization.
  */
@@ -159,6 +169,7 @@ struct crypt_config {
 	sector_t start;
 
 	struct percpu_counter n_allocated_pages;
+	struct crypt_stats __percpu *stats;
 
 	struct workqueue_struct *io_queue;
 	struct workqueue_struct *crypt_queue;
@@ -1587,7 +1598,7 @@ static void crypt_free_req(struct crypt_config *cc, void *req, struct bio *base_
 /*
  * Encrypt / decrypt data from one bio to another one (can be the same one)
  */
-static blk_status_t crypt_convert(struct crypt_config *cc,
+static blk_status_t __crypt_convert(struct crypt_config *cc,
 			 struct convert_context *ctx, bool atomic, bool reset_pending)
 {
 	unsigned int sector_step = cc->sector_size >> SECTOR_SHIFT;
@@ -1680,6 +1691,23 @@ static blk_status_t crypt_convert(struct crypt_config *cc,
 	return 0;
 }
 
+static blk_status_t crypt_convert(struct crypt_config *cc,
+			 struct convert_context *ctx, bool atomic, bool reset_pending)
+{
+	int rw = bio_data_dir(ctx->bio_in);
+	u64 start_sector = ctx->cc_sector;
+	u64 start_ns = ktime_get_ns();
+	blk_status_t r;
+
+	r = __crypt_convert(cc, ctx, atomic, reset_pending);
+
+	this_cpu_add(cc->stats->bytes[rw],
+		     (ctx->cc_sector - start_sector) << SECTOR_SHIFT);
+	this_cpu_add(cc->stats->ns[rw], ktime_get_ns() - start_ns);
+
+	return r;
+}
+
 static void crypt_free_buffer_pages(struct crypt_config *cc, struct bio *clone);
 
 /*
@@ -2800,6 +2828,7 @@ static void crypt_dtr(struct dm_target *ti)
 
 	WARN_ON(percpu_counter_sum(&cc->n_allocated_pages) != 0);
 	percpu_counter_destroy(&cc->n_allocated_pages);
+	free_percpu(cc->stats);
 
 	if (cc->iv_gen_ops && cc->iv_gen_ops->dtr)
 		cc->iv_gen_ops->dtr(cc);
@@ -3298,6 +3327,13 @@ static int crypt_ctr(struct dm_target *ti, unsigned int argc, char **argv)
 	if (ret < 0)
 		goto bad;
 
+	cc->stats = alloc_percpu(struct crypt_stats);
+	if (!cc->stats) {
+		ti->error = "Cannot allocate statistics";
+		ret = -ENOMEM;
+		goto bad;
+	}
+
 	/* Optional parameters need to be read before cipher constructor */
 	if (argc > 5) {
 		ret = crypt_ctr_optional(ti, argc - 5, &argv[5]);
@@ -3570,12 +3606,24 @@ static void crypt_status(struct dm_target *ti, status_type_t type,
 			 unsigned int status_flags, char *result, unsigned int maxlen)
 {
 	struct crypt_config *cc = ti->private;
+	struct crypt_stats stats = { };
 	unsigned int i, sz = 0;
 	int num_feature_args = 0;
+	int cpu;
 
 	switch (type) {
 	case STATUSTYPE_INFO:
-		result[0] = '\0';
+		for_each_possible_cpu(cpu) {
+			struct crypt_stats *s = per_cpu_ptr(cc->stats, cpu);
+
+			for (i = 0; i < 2; i++) {
+				stats.bytes[i] += READ_ONCE(s->bytes[i]);
+				stats.ns[i] += READ_ONCE(s->ns[i]);
+			}
+		}
+		DMEMIT("%llu %llu %llu %llu",
+		       stats.bytes[WRITE], stats.ns[WRITE],
+		       stats.bytes[READ], stats.ns[READ]);
 		break;
 
 	case STATUSTYPE_TABLE:
@@ -3766,7 +3814,7 @@ static void crypt_io_hints(struct dm_target *ti, struct queue_limits *limits)
 
 static struct target_type crypt_target = {
 	.name   = "crypt",
-	.version = {1, 28, 0},
+	.version = {1, 29, 0},
 	.module = THIS_MODULE,
 	.ctr    = crypt_ctr,
 	.dtr    = crypt_dtr,
@@ -1817,8 +1817,8 @@ static void hash_data_vio(struct vdo_completion *completion)
 	assert_data_vio_on_cpu_thread(data_vio);
 	VDO_ASSERT_LOG_ONLY(!data_vio->is_zero, "zero blocks should not be hashed");
 
-	murmurhash3_128(data_vio->vio.data, VDO_BLOCK_SIZE, 0x62ea60be,
-			&data_vio->record_name);
+	BUILD_BUG_ON(VDO_BLOCK_SIZE != 4096);
+	murmurhash3_128_4k(data_vio->vio.data, 0x62ea60be, &data_vio->record_name);
 
 	data_vio->hash_zone = vdo_select_hash_zone(vdo_from_data_vio(data_vio)->hash_zones,
 						   &data_vio->record_name);
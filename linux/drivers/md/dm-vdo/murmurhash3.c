@@ -30,7 +30,12 @@ static __always_inline u64 fmix64(u64 k)
 	return k;
 }
 
-void murmurhash3_128(const void *key, const int len, const u32 seed, void *out)
+/*
+ * The body is inlined into each entry point so that a caller with a
+ * constant length gets a fixed trip count and no tail handling.
+ */
+static __always_inline void __murmurhash3_128(const void *key, const int len,
+					      const u32 seed, void *out)
 {
 	const u8 *data = key;
 	const int nblocks = len / 16;
@@ -153,3 +158,13 @@ void murmurhash3_128(const void *key, const int len, const u32 seed, void *out)
 	put_unaligned_le64(h1, &hash_out[0]);
 	put_unaligned_le64(h2, &hash_out[1]);
 }
+
+void murmurhash3_128(const void *key, const int len, const u32 seed, void *out)
+{
+	__murmurhash3_128(key, len, seed, out);
+}
+
+void murmurhash3_128_4k(const void *key, const u32 seed, void *out)
+{
+	__murmurhash3_128(key, 4096, seed, out);
+}
@@ -12,4 +12,7 @@
 
 void murmurhash3_128(const void *key, int len, u32 seed, void *out);
 
+/* Equivalent to murmurhash3_128() with a len of 4096. */
+void murmurhash3_128_4k(const void *key, u32 seed, void *out);
+
 #endif /* _MURMURHASH3_H_ */
@@ -337,8 +337,12 @@ int verity_hash_for_block(struct dm_verity *v, struct dm_verity_io *io,
 		 * chain verification.
 		 */
 		r = verity_verify_level(v, io, block, 0, true, digest);
-		if (likely(r <= 0))
+		if (likely(r <= 0)) {
+			if (!r)
+				percpu_counter_inc(&v->hash_hits);
 			goto out;
+		}
+		percpu_counter_inc(&v->hash_misses);
 	}
 
 	memcpy(digest, v->root_digest, v->digest_size);
@@ -774,7 +778,9 @@ static void verity_status(struct dm_target *ti, status_type_t type,
 
 	switch (type) {
 	case STATUSTYPE_INFO:
-		DMEMIT("%c", v->hash_failed ? 'C' : 'V');
+		DMEMIT("%c %lld %lld", v->hash_failed ? 'C' : 'V',
+		       percpu_counter_sum_positive(&v->hash_hits),
+		       percpu_counter_sum_positive(&v->hash_misses));
 		break;
 	case STATUSTYPE_TABLE:
 		DMEMIT("%u %s %s %u %u %llu %llu %s ",
@@ -1003,6 +1009,8 @@ static void verity_dtr(struct dm_target *ti)
 		dm_bufio_client_destroy(v->bufio);
 
 	kvfree(v->validated_blocks);
+	percpu_counter_destroy(&v->hash_hits);
+	percpu_counter_destroy(&v->hash_misses);
 	kfree(v->salt);
 	kfree(v->initial_hashstate);
 	kfree(v->root_digest);
@@ -1338,6 +1346,14 @@ static int verity_ctr(struct dm_target *ti, unsigned int argc, char **argv)
 	ti->private = v;
 	v->ti = ti;
 
+	r = percpu_counter_init(&v->hash_hits, 0, GFP_KERNEL);
+	if (!r)
+		r = percpu_counter_init(&v->hash_misses, 0, GFP_KERNEL);
+	if (r) {
+		ti->error = "Cannot allocate hash counters";
+		goto bad;
+	}
+
 	r = verity_fec_ctr_alloc(v);
 	if (r)
 		goto bad;
@@ -1690,7 +1706,7 @@ static struct target_type verity_target = {
 	.name		= "verity",
 /* Note: the LSMs depend on the singleton and immutable features */
 	.features	= DM_TARGET_SINGLETON | DM_TARGET_IMMUTABLE,
-	.version	= {1, 12, 0},
+	.version	= {1, 13, 0},
 	.module		= THIS_MODULE,
 	.ctr		= verity_ctr,
 	.dtr		= verity_dtr,
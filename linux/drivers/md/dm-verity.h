@@ -15,6 +15,7 @@
 #include <linux/dm-bufio.h>
 #include <linux/device-mapper.h>
 #include <linux/interrupt.h>
+#include <linux/percpu_counter.h>
 #include <crypto/hash.h>
 
 #define DM_VERITY_MAX_LEVELS		63
@@ -76,6 +77,11 @@ struct dm_verity {
 
 	struct dm_io_client *io;
 	mempool_t recheck_pool;
+
+	/* lowest level hash lookups served by an already verified block */
+	struct percpu_counter hash_hits;
+	/* lookups that had to walk and verify the hash tree */
+	struct percpu_counter hash_misses;
 };
 
 struct dm_verity_io {
@@ -214,6 +214,8 @@ struct dm_writecache {
 		unsigned long long writes_blocked_on_freelist;
 		unsigned long long flushes;
 		unsigned long long discards;
+		unsigned long long writeback_blocks;
+		unsigned long long writeback_ios;
 	} stats;
 };
 
@@ -1692,6 +1694,8 @@ static void __writecache_endio_pmem(struct dm_writecache *wc, struct list_head *
 		if (unlikely(wb->bio.bi_status != BLK_STS_OK))
 			writecache_error(wc, blk_status_to_errno(wb->bio.bi_status),
 					"write error %d", wb->bio.bi_status);
+		wc->stats.writeback_ios++;
+		wc->stats.writeback_blocks += wb->wc_list_n;
 		i = 0;
 		do {
 			e = wb->wc_list[i];
@@ -1728,6 +1732,8 @@ static void __writecache_endio_ssd(struct dm_writecache *wc, struct list_head *l
 
 		if (unlikely(c->error))
 			writecache_error(wc, c->error, "copy error");
+		wc->stats.writeback_ios++;
+		wc->stats.writeback_blocks += c->n_entries;
 
 		e = c->e;
 		do {
@@ -2685,7 +2691,7 @@ static void writecache_status(struct dm_target *ti, status_type_t type,
 
 	switch (type) {
 	case STATUSTYPE_INFO:
-		DMEMIT("%ld %llu %llu %llu %llu %llu %llu %llu %llu %llu %llu %llu %llu %llu",
+		DMEMIT("%ld %llu %llu %llu %llu %llu %llu %llu %llu %llu %llu %llu %llu %llu %llu %llu",
 		       writecache_has_error(wc),
 		       (unsigned long long)wc->n_blocks, (unsigned long long)wc->freelist_size,
 		       (unsigned long long)wc->writeback_size,
@@ -2698,7 +2704,9 @@ static void writecache_status(struct dm_target *ti, status_type_t type,
 		       wc->stats.writes_allocate,
 		       wc->stats.writes_blocked_on_freelist,
 		       wc->stats.flushes,
-		       wc->stats.discards);
+		       wc->stats.discards,
+		       wc->stats.writeback_blocks,
+		       wc->stats.writeback_ios);
 		break;
 	case STATUSTYPE_TABLE:
 		DMEMIT("%c %s %s %u ", WC_MODE_PMEM(wc) ? 'p' : 's',
@@ -2759,7 +2767,7 @@ static void writecache_status(struct dm_target *ti, status_type_t type,
 
 static struct target_type writecache_target = {
 	.name			= "writecache",
-	.version		= {1, 6, 0},
+	.version		= {1, 7, 0},
 	.module			= THIS_MODULE,
 	.ctr			= writecache_ctr,
 	.dtr			= writecache_dtr,
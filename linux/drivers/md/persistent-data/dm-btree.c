@@ -1464,12 +1464,10 @@ EXPORT_SYMBOL_GPL(dm_btree_walk);
 
 /*----------------------------------------------------------------*/
 
-static void prefetch_values(struct dm_btree_cursor *c)
+static void __prefetch_values(struct dm_btree_cursor *c, struct btree_node *bn)
 {
 	unsigned int i, nr;
 	__le64 value_le;
-	struct cursor_node *n = c->nodes + c->depth - 1;
-	struct btree_node *bn = dm_block_data(n->b);
 	struct dm_block_manager *bm = dm_tm_get_bm(c->info->tm);
 
 	BUG_ON(c->info->value_type.size != sizeof(value_le));
@@ -1481,6 +1479,13 @@ static void prefetch_values(struct dm_btree_cursor *c)
 	}
 }
 
+static void prefetch_values(struct dm_btree_cursor *c)
+{
+	struct cursor_node *n = c->nodes + c->depth - 1;
+
+	__prefetch_values(c, dm_block_data(n->b));
+}
+
 static bool leaf_node(struct dm_btree_cursor *c)
 {
 	struct cursor_node *n = c->nodes + c->depth - 1;
@@ -1489,6 +1494,48 @@ static bool leaf_node(struct dm_btree_cursor *c)
 	return le32_to_cpu(bn->header.flags) & LEAF_NODE;
 }
 
+/*
+ * Children of an internal node are only prefetched once the cursor
+ * reaches that node, so every crossing between internal nodes used to
+ * stall on a synchronous read of the first child.  When the cursor
+ * descends into the last child of its parent we peek at the parent's
+ * next sibling and, if it is already cached (its grandparent prefetched
+ * it), kick off reads of its children too.  Never blocks.
+ */
+static void prefetch_next_sibling(struct dm_btree_cursor *c)
+{
+	struct cursor_node *p, *gp;
+	struct btree_node *pn, *gpn;
+	struct dm_block *b;
+	dm_block_t sibling;
+
+	if (c->depth < 3)
+		return;
+
+	/* the sibling's children are at our level, as in push_node() */
+	if (!c->prefetch_leaves && leaf_node(c))
+		return;
+
+	p = c->nodes + c->depth - 2;
+	pn = dm_block_data(p->b);
+	if (p->index + 1 < le32_to_cpu(pn->header.nr_entries))
+		return;
+
+	gp = c->nodes + c->depth - 3;
+	gpn = dm_block_data(gp->b);
+	if (gp->index + 1 >= le32_to_cpu(gpn->header.nr_entries))
+		return;
+
+	sibling = value64(gpn, gp->index + 1);
+	if (dm_bm_read_try_lock(dm_tm_get_bm(c->info->tm), sibling,
+				&btree_node_validator, &b))
+		return;
+
+	/* the sibling is at the parent's level, so it's always internal */
+	__prefetch_values(c, dm_block_data(b));
+	dm_bm_unlock(b);
+}
+
 static int push_node(struct dm_btree_cursor *c, dm_block_t b)
 {
 	int r;
@@ -1509,6 +1556,8 @@ static int push_node(struct dm_btree_cursor *c, dm_block_t b)
 	if (c->prefetch_leaves || !leaf_node(c))
 		prefetch_values(c);
 
+	prefetch_next_sibling(c);
+
 	return 0;
 }
 
@@ -171,6 +171,29 @@ static bool stripe_is_lowprio(struct stripe_head *sh)
 	       !test_bit(STRIPE_R5C_CACHING, &sh->state);
 }
 
+/*
+ * Wake the first worker of a group that has nothing queued, so that it can
+ * take stripes from @busy, see __steal_stripe().
+ */
+static void raid5_wakeup_idle_group(struct r5conf *conf,
+				    struct r5worker_group *busy)
+	__must_hold(&conf->device_lock)
+{
+	struct r5worker_group *group;
+	int i;
+
+	for (i = 0; i < conf->group_cnt; i++) {
+		group = &conf->worker_groups[i];
+		if (group == busy || group->stripes_cnt ||
+		    group->workers[0].working)
+			continue;
+
+		group->workers[0].working = true;
+		queue_work_node(i, raid5_wq, &group->workers[0].work);
+		return;
+	}
+}
+
 static void raid5_wakeup_stripe_thread(struct stripe_head *sh)
 	__must_hold(&sh->raid_conf->device_lock)
 {
@@ -216,6 +239,13 @@ static void raid5_wakeup_stripe_thread(struct stripe_head *sh)
 			thread_cnt--;
 		}
 	}
+
+	/*
+	 * All workers of this group are busy and there is still more than a
+	 * batch left for them, let an idle group steal some of it.
+	 */
+	if (thread_cnt > 0)
+		raid5_wakeup_idle_group(conf, group);
 }
 
 static void do_release_stripe(struct r5conf *conf, struct stripe_head *sh,
@@ -5487,6 +5517,37 @@ static struct bio *chunk_aligned_read(struct mddev *mddev, struct bio *raid_bio)
 	return NULL;
 }
 
+/*
+ * The handle lists of @group are empty. Rather than letting its worker go
+ * idle, take a stripe from the most backlogged other group, if that group
+ * has more than a batch worth of stripes queued.
+ */
+static struct stripe_head *__steal_stripe(struct r5conf *conf, int group)
+	__must_hold(&conf->device_lock)
+{
+	struct r5worker_group *wg, *busiest = NULL;
+	struct stripe_head *sh;
+	int i;
+
+	for (i = 0; i < conf->group_cnt; i++) {
+		wg = &conf->worker_groups[i];
+		if (i == group || list_empty(&wg->handle_list))
+			continue;
+		if (!busiest || wg->stripes_cnt > busiest->stripes_cnt)
+			busiest = wg;
+	}
+
+	if (!busiest || busiest->stripes_cnt <= MAX_STRIPE_BATCH)
+		return NULL;
+
+	sh = list_first_entry(&busiest->handle_list, struct stripe_head, lru);
+	busiest->stripes_cnt--;
+	sh->group = NULL;
+	list_del_init(&sh->lru);
+	BUG_ON(atomic_inc_return(&sh->count) != 1);
+	return sh;
+}
+
 /* __get_priority_stripe - get the next stripe to process
  *
  * Full stripe writes are allowed to pass preread active stripes up until
@@ -5574,8 +5635,11 @@ again:
 	}
 
 	if (!sh) {
-		if (second_try)
+		if (second_try) {
+			if (conf->worker_cnt_per_group && group != ANY_GROUP)
+				return __steal_stripe(conf, group);
 			return NULL;
+		}
 		second_try = true;
 		try_loprio = !try_loprio;
 		goto again;
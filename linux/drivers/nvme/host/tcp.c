@@ -155,6 +155,8 @@ struct nvme_tcp_queue {
 	size_t			data_remaining;
 	size_t			ddgst_remaining;
 	unsigned int		nr_cqe;
+	/* only set while polling, protected by the socket lock */
+	struct io_comp_batch	*iob;
 
 	/* send state */
 	struct nvme_tcp_request *request;
@@ -618,6 +620,30 @@ static void nvme_tcp_error_recovery(struct nvme_ctrl *ctrl)
 	queue_work(nvme_reset_wq, &to_tcp_ctrl(ctrl)->err_work);
 }
 
+static void nvme_tcp_complete_batch(struct io_comp_batch *iob)
+{
+	struct request *req;
+
+	rq_list_for_each(&iob->req_list, req)
+		nvme_complete_batch_req(req);
+	blk_mq_end_request_batch(iob);
+}
+
+/*
+ * Complete a request from the receive path.  When called from
+ * nvme_tcp_poll() successful completions are handed back to the poller in
+ * a batch instead of being ended one at a time.
+ */
+static void nvme_tcp_recv_complete(struct nvme_tcp_queue *queue,
+		struct request *rq, __le16 status, union nvme_result result)
+{
+	if (!nvme_try_complete_req(rq, status, result) &&
+	    !blk_mq_add_to_batch(rq, queue->iob,
+				 nvme_req(rq)->status != NVME_SC_SUCCESS,
+				 nvme_tcp_complete_batch))
+		nvme_complete_rq(rq);
+}
+
 static int nvme_tcp_process_nvme_cqe(struct nvme_tcp_queue *queue,
 		struct nvme_completion *cqe)
 {
@@ -637,8 +663,7 @@ static int nvme_tcp_process_nvme_cqe(struct nvme_tcp_queue *queue,
 	if (req->status == cpu_to_le16(NVME_SC_SUCCESS))
 		req->status = cqe->status;
 
-	if (!nvme_try_complete_req(rq, req->status, cqe->result))
-		nvme_complete_rq(rq);
+	nvme_tcp_recv_complete(queue, rq, req->status, cqe->result);
 	queue->nr_cqe++;
 
 	return 0;
@@ -907,6 +932,14 @@ static inline void nvme_tcp_end_request(struct request *rq, u16 status)
 		nvme_complete_rq(rq);
 }
 
+static inline void nvme_tcp_recv_end_request(struct nvme_tcp_queue *queue,
+		struct request *rq, u16 status)
+{
+	union nvme_result res = {};
+
+	nvme_tcp_recv_complete(queue, rq, cpu_to_le16(status << 1), res);
+}
+
 static int nvme_tcp_recv_data(struct nvme_tcp_queue *queue, struct sk_buff *skb,
 			      unsigned int *offset, size_t *len)
 {
@@ -967,7 +1000,7 @@ static int nvme_tcp_recv_data(struct nvme_tcp_queue *queue, struct sk_buff *skb,
 			queue->ddgst_remaining = NVME_TCP_DIGEST_LENGTH;
 		} else {
 			if (pdu->hdr.flags & NVME_TCP_F_DATA_SUCCESS) {
-				nvme_tcp_end_request(rq,
+				nvme_tcp_recv_end_request(queue, rq,
 						le16_to_cpu(req->status));
 				queue->nr_cqe++;
 			}
@@ -1015,7 +1048,7 @@ static int nvme_tcp_recv_ddgst(struct nvme_tcp_queue *queue,
 					pdu->command_id);
 		struct nvme_tcp_request *req = blk_mq_rq_to_pdu(rq);
 
-		nvme_tcp_end_request(rq, le16_to_cpu(req->status));
+		nvme_tcp_recv_end_request(queue, rq, le16_to_cpu(req->status));
 		queue->nr_cqe++;
 	}
 
@@ -1353,7 +1386,8 @@ out:
 	return ret;
 }
 
-static int nvme_tcp_try_recv(struct nvme_tcp_queue *queue)
+static int nvme_tcp_try_recv(struct nvme_tcp_queue *queue,
+		struct io_comp_batch *iob)
 {
 	struct socket *sock = queue->sock;
 	struct sock *sk = sock->sk;
@@ -1364,7 +1398,9 @@ static int nvme_tcp_try_recv(struct nvme_tcp_queue *queue)
 	rd_desc.count = 1;
 	lock_sock(sk);
 	queue->nr_cqe = 0;
+	queue->iob = iob;
 	consumed = sock->ops->read_sock(sk, &rd_desc, nvme_tcp_recv_skb);
+	queue->iob = NULL;
 	release_sock(sk);
 	return consumed == -EAGAIN ? 0 : consumed;
 }
@@ -1388,7 +1424,7 @@ static void nvme_tcp_io_work(struct work_struct *w)
 				break;
 		}
 
-		result = nvme_tcp_try_recv(queue);
+		result = nvme_tcp_try_recv(queue, NULL);
 		if (result > 0)
 			pending = true;
 		else if (unlikely(result < 0))
@@ -2794,7 +2830,7 @@ static int nvme_tcp_poll(struct blk_mq_hw_ctx *hctx, struct io_comp_batch *iob)
 	set_bit(NVME_TCP_Q_POLLING, &queue->flags);
 	if (sk_can_busy_loop(sk) && skb_queue_empty_lockless(&sk->sk_receive_queue))
 		sk_busy_loop(sk, true);
-	ret = nvme_tcp_try_recv(queue);
+	ret = nvme_tcp_try_recv(queue, iob);
 	clear_bit(NVME_TCP_Q_POLLING, &queue->flags);
 	return ret < 0 ? ret : queue->nr_cqe;
 }
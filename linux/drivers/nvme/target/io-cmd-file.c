@@ -179,6 +179,16 @@ static bool nvmet_file_execute_io(struct nvmet_req *req, int ki_flags)
 
 	ret = nvmet_file_submit_bvec(req, pos, bv_cnt, total_len, ki_flags);
 
+	/*
+	 * A buffered IOCB_NOWAIT read or write stops at the first page that
+	 * would block and returns what it managed so far.  Don't fail the
+	 * command for that, redo it from the worker: reissuing the same
+	 * data at the same offset is harmless, and the part already done
+	 * is now in the page cache.
+	 */
+	if ((ki_flags & IOCB_NOWAIT) && ret >= 0 && ret < total_len)
+		return false;
+
 	switch (ret) {
 	case -EIOCBQUEUED:
 		return true;
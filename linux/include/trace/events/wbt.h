@@ -77,6 +77,49 @@ TRACE_EVENT(wbt_lat,
 			(unsigned long long) __entry->lat)
 );
 
+/**
+ * wbt_pct - trace percentile controller window
+ * @rp50: read p50 latency
+ * @rp99: read p99 latency
+ * @wp99: write p99 latency
+ * @target: read p99 latency target
+ * @rsamples: read completions in the window
+ * @wsamples: write completions in the window
+ */
+TRACE_EVENT(wbt_pct,
+
+	TP_PROTO(struct backing_dev_info *bdi, u64 rp50, u64 rp99, u64 wp99,
+		 u64 target, u64 rsamples, u64 wsamples),
+
+	TP_ARGS(bdi, rp50, rp99, wp99, target, rsamples, wsamples),
+
+	TP_STRUCT__entry(
+		__array(char, name, 32)
+		__field(u64, rp50)
+		__field(u64, rp99)
+		__field(u64, wp99)
+		__field(u64, target)
+		__field(u64, rsamples)
+		__field(u64, wsamples)
+	),
+
+	TP_fast_assign(
+		strscpy(__entry->name, bdi_dev_name(bdi),
+			ARRAY_SIZE(__entry->name));
+		__entry->rp50		= div_u64(rp50, 1000);
+		__entry->rp99		= div_u64(rp99, 1000);
+		__entry->wp99		= div_u64(wp99, 1000);
+		__entry->target		= div_u64(target, 1000);
+		__entry->rsamples	= rsamples;
+		__entry->wsamples	= wsamples;
+	),
+
+	TP_printk("%s: rp50=%lluus, rp99=%lluus, wp99=%lluus, target=%lluus, "
+		  "rsamples=%llu, wsamples=%llu",
+		  __entry->name, __entry->rp50, __entry->rp99, __entry->wp99,
+		  __entry->target, __entry->rsamples, __entry->wsamples)
+);
+
 /**
  * wbt_step - trace wb event step
  * @msg: context message
@@ -102,6 +102,10 @@
 	_IOWR('u', 0x23, struct ublksrv_io_cmd)
 #define	UBLK_U_IO_UNREGISTER_IO_BUF	\
 	_IOWR('u', 0x24, struct ublksrv_io_cmd)
+#define	UBLK_U_IO_FETCH_IO_CMDS		\
+	_IOWR('u', 0x25, struct ublk_batch_io)
+#define	UBLK_U_IO_COMMIT_IO_CMDS	\
+	_IOWR('u', 0x26, struct ublk_batch_io)
 
 /* only ABORT means that no re-fetch */
 #define UBLK_IO_RES_OK			0
@@ -311,6 +315,34 @@
  */
 #define UBLK_F_BUF_REG_OFF_DAEMON (1ULL << 14)
 
+/*
+ * Batched IO commands: instead of one uring_cmd per tag, each queue is
+ * driven by two commands which handle many IOs at a time:
+ *
+ * - `UBLK_U_IO_FETCH_IO_CMDS` sets up the queue the first time it is issued,
+ *   and completes once new IO requests are available. `ublk_batch_io.addr`
+ *   points to an array of `ublk_batch_io.nr_elem` __u16 slots, the tags of
+ *   the delivered requests are stored there and the cqe's result is the
+ *   number of stored tags. Only one fetch command may be pending per queue,
+ *   and it has to be re-issued from the queue's daemon task after each
+ *   completion.
+ *
+ * - `UBLK_U_IO_COMMIT_IO_CMDS` completes the IOs described by the
+ *   `ublk_batch_io.nr_elem` entries of `struct ublk_batch_commit_elem` at
+ *   `ublk_batch_io.addr`. The cqe's result is the number of committed
+ *   entries, or a negative error if not even the first one was valid.
+ *
+ * The per-IO commands `UBLK_U_IO_FETCH_REQ`, `UBLK_U_IO_COMMIT_AND_FETCH_REQ`
+ * and `UBLK_U_IO_NEED_GET_DATA` are rejected in this mode.
+ *
+ * This feature requires UBLK_F_USER_COPY, UBLK_F_SUPPORT_ZERO_COPY or
+ * UBLK_F_AUTO_BUF_REG, and can't be combined with the recovery features.
+ * With UBLK_F_AUTO_BUF_REG, the request buffer is registered at index
+ * `tag` for the first request of each tag, and at the index passed in
+ * `ublk_batch_commit_elem.buf_index` by the previous commit afterwards.
+ */
+#define UBLK_F_BATCH_IO		(1ULL << 15)
+
 /* device state */
 #define UBLK_S_DEV_DEAD	0
 #define UBLK_S_DEV_LIVE	1
@@ -525,6 +557,35 @@ struct ublksrv_io_cmd {
 	};
 };
 
+/* issued to ublk driver via /dev/ublkcN for UBLK_F_BATCH_IO */
+struct ublk_batch_io {
+	__u16	q_id;
+
+	/* UBLK_BATCH_F_* flags, only valid for UBLK_U_IO_COMMIT_IO_CMDS */
+#define UBLK_BATCH_F_AUTO_BUF_REG_FALLBACK	(1 << 0)
+#define UBLK_BATCH_F_MASK	UBLK_BATCH_F_AUTO_BUF_REG_FALLBACK
+	__u16	flags;
+
+	/* number of elements in the array pointed to by `addr` */
+	__u16	nr_elem;
+	__u16	reserved;
+
+	__u64	addr;
+};
+
+struct ublk_batch_commit_elem {
+	__u16	tag;
+
+	/* buffer index for the next request of this tag, UBLK_F_AUTO_BUF_REG */
+	__u16	buf_index;
+
+	/* io result */
+	__s32	result;
+
+	/* the allocated LBA for UBLK_IO_OP_ZONE_APPEND */
+	__u64	zone_append_lba;
+};
+
 struct ublk_param_basic {
 #define UBLK_ATTR_READ_ONLY            (1 << 0)
 #define UBLK_ATTR_ROTATIONAL           (1 << 1)